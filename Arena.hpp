@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+/*
+ArenaAllocator template-class
+
+Hands out memory of a thread local buffer by bumping an offset, deallocation does nothing
+The arena is only used while a Scope lives on the thread, ending a Scope gives back
+everything allocated during its lifetime at once
+Outside of any Scope the global allocator is used, so containers living longer than a search are not affected
+
+Pre-Condition: containers allocated inside a Scope are destroyed before the Scope ends
+*/
+
+namespace arena
+{
+    const std::size_t ARENA_SIZE = 1 << 22;    // bytes of the buffer of every thread
+
+    struct ThreadArena
+    {
+        std::unique_ptr<unsigned char[]> buffer;    // created on first use
+        std::size_t offset = 0;                     // first free byte of buffer
+        int scopes = 0;                             // living Scope objects of the thread
+        std::size_t fallbacks = 0;                  // allocations inside a Scope that did not fit into buffer
+    };
+
+    ThreadArena& thread_arena()
+    {
+        thread_local ThreadArena arena;
+        return arena;
+    }
+
+    std::size_t fallback_allocations()
+    // return number of allocations that went to the global allocator inside a Scope on this thread
+    {
+        return thread_arena().fallbacks;
+    }
+
+    class Scope{
+    public:
+        Scope()
+            :arena(thread_arena()), mark(arena.offset)
+        {
+            ++arena.scopes;
+        }
+
+        ~Scope()
+        {
+            arena.offset = mark;
+            --arena.scopes;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        ThreadArena& arena;
+        const std::size_t mark;  // offset when the scope started
+    };
+
+    template <typename T>
+    class ArenaAllocator{
+    public:
+        typedef T value_type;
+
+        ArenaAllocator() noexcept {   }
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>&) noexcept {   }
+
+        T* allocate(std::size_t n)
+        {
+            ThreadArena& arena = thread_arena();
+            const std::size_t bytes = n * sizeof(T);
+
+            if (arena.scopes > 0)
+            {
+                if (!arena.buffer)
+                    arena.buffer.reset(new unsigned char[ARENA_SIZE]);
+
+                const std::size_t start = (arena.offset + alignof(T) - 1) & ~(alignof(T) - 1);
+                if (start + bytes <= ARENA_SIZE)
+                {
+                    arena.offset = start + bytes;
+                    return reinterpret_cast<T*>(arena.buffer.get() + start);
+                }
+                ++arena.fallbacks;
+            }
+
+            return static_cast<T*>(::operator new(bytes));
+        }
+
+        void deallocate(T* p, std::size_t) noexcept
+        {
+            const unsigned char* memory = reinterpret_cast<const unsigned char*>(p);
+            const unsigned char* buffer = thread_arena().buffer.get();
+
+            // arena memory is given back when its Scope ends
+            if (buffer != nullptr && buffer <= memory && memory < buffer + ARENA_SIZE)
+                return;
+
+            ::operator delete(p);
+        }
+    };
+
+    template <typename T, typename U>
+    bool operator==(const ArenaAllocator<T>&, const ArenaAllocator<U>&)
+    {
+        return true;
+    }
+
+    template <typename T, typename U>
+    bool operator!=(const ArenaAllocator<T>&, const ArenaAllocator<U>&)
+    {
+        return false;
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*
+Executor class
+
+Fixed pool of threads running submitted tasks in submission order
+submit returns a future of the task result, an exception thrown by the task is rethrown by its get()
+The destructor lets the threads finish every queued task before joining them
+*/
+
+namespace executor
+{
+    class Executor{
+    public:
+        explicit Executor(unsigned threads = std::max(1u, std::thread::hardware_concurrency()))
+        {
+            for (unsigned i = 0; i < threads; ++i)
+                workers.emplace_back([this]{ work(); });
+        }
+
+        ~Executor()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            task_added.notify_all();
+
+            for (auto& worker : workers)
+                worker.join();
+        }
+
+        Executor(const Executor&) = delete;
+        Executor& operator=(const Executor&) = delete;
+
+        template <typename F>
+        std::future<std::invoke_result_t<F>> submit(F&& task)
+        {
+            // std::function needs a copyable target, the packaged task is shared instead of copied
+            auto packaged = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(task));
+            auto result = packaged->get_future();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.emplace_back([packaged]{ (*packaged)(); });
+            }
+            task_added.notify_one();
+            return result;
+        }
+
+        std::size_t size() const
+        {
+            return workers.size();
+        }
+
+    private:
+        void work()
+        {
+            while (true)
+            {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    task_added.wait(lock, [this]{ return stopping || !tasks.empty(); });
+
+                    if (tasks.empty())
+                        return;
+
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                }
+                task();
+            }
+        }
+
+        std::vector<std::thread> workers;
+
+        std::mutex mutex;
+        std::condition_variable task_added;
+        std::deque<std::function<void()>> tasks;
+        bool stopping = false;
+    };
+}
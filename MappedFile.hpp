@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Exception.hpp"
+
+/*
+MappedFile class
+
+View of a whole file mapped into memory
+Pages are loaded by the kernel on first access, so large files are read without copying them into buffers
+A copy on write mapping can be changed in memory, the file stays untouched
+and every page not written yet is shared with all other processes mapping the same file
+*/
+
+namespace io
+{
+    const Exception FileMapError{"FileMapError: File Can Not Be Opened Or Mapped"};
+
+    enum class Access
+    {
+        ReadOnly,       // read front to back
+        CopyOnWrite     // read and written anywhere, writes stay private to the process
+    };
+
+    class MappedFile{
+    public:
+        explicit MappedFile(const std::string& path, Access access = Access::ReadOnly)
+        {
+            const int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw FileMapError;
+
+            struct stat status;
+            if (fstat(fd, &status) < 0)
+            {
+                close(fd);
+                throw FileMapError;
+            }
+
+            length = static_cast<std::size_t>(status.st_size);
+            if (length > 0)
+            {
+                const int protection = (access == Access::CopyOnWrite) ? PROT_READ | PROT_WRITE : PROT_READ;
+                memory = mmap(nullptr, length, protection, MAP_PRIVATE, fd, 0);
+                if (memory == MAP_FAILED)
+                {
+                    memory = nullptr;
+                    close(fd);
+                    throw FileMapError;
+                }
+                madvise(memory, length, (access == Access::CopyOnWrite) ? MADV_WILLNEED : MADV_SEQUENTIAL);
+            }
+
+            // the mapping stays valid without the descriptor
+            close(fd);
+        }
+
+        ~MappedFile()
+        {
+            if (memory != nullptr)
+                munmap(memory, length);
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        std::string_view data() const
+        {
+            return std::string_view{static_cast<const char*>(memory), length};
+        }
+
+        // Pre-Condition: file is mapped with Access::CopyOnWrite
+        char* writable_data()
+        {
+            return static_cast<char*>(memory);
+        }
+
+        std::size_t size() const
+        {
+            return length;
+        }
+
+    private:
+        void* memory = nullptr;
+        std::size_t length = 0;
+    };
+}
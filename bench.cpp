@@ -0,0 +1,202 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "chess_bot.hpp"
+#include "chess_board.hpp"
+
+/*
+Fixed depth search over a set of positions
+Prints node counts and time for every configuration of the selective search
+how much faster the positions are searched again from a saved transposition table
+and what ranking the best MULTI_PV root moves costs compared to finding only the best one
+
+    bench [network file]    --> engines evaluate with the network instead of the hand written evaluation
+    built with -DCHESS_COUNTERS the hot path counters of all runs are printed at the end
+    exits with 1 if a search node allocated beyond its arena, arena::ARENA_SIZE is too small then
+    bench --trace FILE      --> only searches the positions with all selective parts and records the search tree into FILE,
+                                needs a build with -DCHESS_TRACE, trace_report reads FILE
+*/
+
+using namespace cbn;
+using namespace lmn;
+using namespace cbot;
+
+const int BENCH_DEPTH = 5;
+const char* SNAPSHOT_PATH = "bench.tt";
+const int MULTI_PV = 3;
+
+// positions are given as the moves leading to them from the starting position
+const std::vector<std::string> BENCH_POSITIONS
+{
+    "",
+    "e7 e5 e2 e4 g8 f6 b1 c3",
+    "d7 d5 d2 d4 c7 c5 e2 e3 b8 c6 g1 f3",
+    "e7 e5 c2 c4 g8 f6 b1 c3 f8 c5 g1 f3 e8 g8",
+};
+
+ChessCoordinate coordinate(const std::string& square)
+{
+    return ChessCoordinate{square[0] - ALPHABET_TO_INT, square[1] - '0' - INDEX_TO_NUM};
+}
+
+ChessBoard play(const std::string& moves)
+// return board after playing moves from the starting position
+{
+    ChessBoard board{};
+    Legalmoves legal{board};
+
+    std::istringstream is{moves};
+    std::string from, to;
+
+    while (is >> from >> to)
+    {
+        ChessNotation move{coordinate(from), coordinate(to)};
+        board.move(legal.get_legal_moves(move.from), move);
+    }
+
+    return board;
+}
+
+std::shared_ptr<const nnue::Network> network;   // nullptr --> hand written evaluation
+
+void run(const std::string& name, const SearchOptions& options)
+{
+    std::size_t total_nodes = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (const auto& position : BENCH_POSITIONS)
+    {
+        Engine engine{options, network};
+        engine.best_notation(play(position), BENCH_DEPTH);
+        total_nodes += engine.nodes();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << name << ": " << total_nodes << " nodes " << elapsed.count() << " s "
+              << static_cast<std::size_t>(total_nodes / elapsed.count()) << " nps\n";
+}
+
+void warm_start()
+// search every position twice, the second engine starts from the table the first one saved
+{
+    std::size_t cold_nodes = 0, warm_nodes = 0;
+    std::chrono::duration<double> cold_time{0}, warm_time{0};
+
+    for (const auto& position : BENCH_POSITIONS)
+    {
+        const ChessBoard board = play(position);
+
+        Engine cold{SearchOptions{}, network};
+        auto start = std::chrono::steady_clock::now();
+        cold.best_notation(board, BENCH_DEPTH);
+        cold_time += std::chrono::steady_clock::now() - start;
+        cold_nodes += cold.nodes();
+        cold.save_table(SNAPSHOT_PATH);
+
+        Engine warm{SearchOptions{}, network};
+        warm.load_table(SNAPSHOT_PATH);
+        start = std::chrono::steady_clock::now();
+        warm.best_notation(board, BENCH_DEPTH);
+        warm_time += std::chrono::steady_clock::now() - start;
+        warm_nodes += warm.nodes();
+    }
+    std::remove(SNAPSHOT_PATH);
+
+    std::cout << "cold start: " << cold_nodes << " nodes " << cold_time.count() << " s\n"
+              << "warm start: " << warm_nodes << " nodes " << warm_time.count() << " s\n";
+}
+
+void multi_pv()
+// search every position once for the best move and once for the best MULTI_PV moves
+{
+    std::size_t single_nodes = 0, multi_nodes = 0;
+    std::chrono::duration<double> single_time{0}, multi_time{0};
+
+    SearchLimits search_limits;
+    search_limits.depth = BENCH_DEPTH;
+
+    for (const auto& position : BENCH_POSITIONS)
+    {
+        const ChessBoard board = play(position);
+
+        Engine single{SearchOptions{}, network};
+        auto start = std::chrono::steady_clock::now();
+        single.search(board, search_limits);
+        single_time += std::chrono::steady_clock::now() - start;
+        single_nodes += single.nodes();
+
+        search_limits.multi_pv = MULTI_PV;
+        Engine multi{SearchOptions{}, network};
+        start = std::chrono::steady_clock::now();
+        multi.search(board, search_limits);
+        multi_time += std::chrono::steady_clock::now() - start;
+        multi_nodes += multi.nodes();
+        search_limits.multi_pv = 1;
+    }
+
+    std::cout << "single pv: " << single_nodes << " nodes " << single_time.count() << " s\n"
+              << "multi pv " << MULTI_PV << ": " << multi_nodes << " nodes " << multi_time.count() << " s\n";
+}
+
+void traced(const std::string& path)
+// one engine searches all positions so the trace holds a thread per search
+{
+    Engine engine{SearchOptions{}, network};
+    engine.start_trace(path);
+
+    for (const auto& position : BENCH_POSITIONS)
+        engine.best_notation(play(position), BENCH_DEPTH);
+    engine.stop_trace();
+
+    std::cout << "trace written to " << path << "\n";
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 2 && std::string{argv[1]} == "--trace")
+    {
+        try {
+            traced(argv[2]);
+        }
+        catch (Exception& e)
+        {
+            std::cerr << argv[2] << ": " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (argc > 1)
+    {
+        try {
+            network = nnue::load_network(argv[1]);
+        }
+        catch (Exception& e)
+        {
+            std::cerr << argv[1] << ": " << e.what() << "\n";
+            return 1;
+        }
+        std::cout << "network " << argv[1] << " with " << nnue::KERNELS.name << " kernels\n";
+    }
+
+    run("alpha-beta", SearchOptions{false, false, false});
+    run("null move", SearchOptions{true, false, false});
+    run("late move reductions", SearchOptions{false, true, false});
+    run("see pruning", SearchOptions{false, false, true});
+    run("null move + late move reductions", SearchOptions{true, true, false});
+    run("null move + late move reductions + see pruning", SearchOptions{true, true, true});
+    warm_start();
+    multi_pv();
+
+    if constexpr (counters::ENABLED)
+        counters::write_snapshot(std::cout);
+
+    // the searches ran on this thread, its arena saw every node
+    const std::size_t fallbacks = arena::fallback_allocations();
+    std::cout << "arena fallback allocations: " << fallbacks << "\n";
+    return fallbacks == 0 ? 0 : 1;
+}
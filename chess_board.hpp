@@ -1,9 +1,17 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <sstream>
+#include <string>
 
 #include "chess_notation.hpp"
 #include "chess_board_constants.hpp"
+#include "chess_counters.hpp"
+#include "chess_square.hpp"
+#include "chess_zobrist.hpp"
 
 namespace cbn
 {
@@ -13,31 +21,66 @@ namespace cbn
     using coordinate_container = container_type<ChessCoordinate, allocator_type<ChessCoordinate>>;
     using notation_container = container_type<ChessNotation, allocator_type<ChessNotation>>;
 
+    // return piece standing on destination after moving there --> pawns reaching the last rank become queens
+    Piece promoted(const Piece& piece, const ChessCoordinate& destination);
+
+    // return FEN letter of piece
+    char piece_letter(const Piece& piece);
+
+    // return piece of FEN letter, throws BadFenError for other characters
+    Piece piece_from_letter(char letter);
+
+    enum class MoveError
+    {
+        None, BadSquare, EmptySquare, WrongColor, Illegal
+    };
+
+    struct MoveRights
+    // what a position holds besides its pieces and the moving color
+    {
+        std::array<std::array<bool, 2>, 2> castling{{{true, true}, {true, true}}};  // [color][left, right rook]
+        ChessCoordinate passant_pawn;   // pawn that just moved two squares, invalid if none can be taken en passant
+    };
+
     class ChessBoard{
 
         public:
+            ChessBoard();
+
+            explicit ChessBoard(const std::string& fen);
+
             friend std::ostream& operator<<(std::ostream& os, const ChessBoard& cb);
 
             void restore();
 
-            Piece& operator[](const ChessCoordinate& location);
-
             const Piece& operator[](const ChessCoordinate& location) const;
 
+            void place(const ChessCoordinate& location, const Piece& piece);
+
+            zobrist::key_type hash() const;
+
+            zobrist::key_type pawn_hash() const;
+
             ChessNotation& last_move();
             const ChessNotation& last_move() const;
 
             bool piece_was_moved(const ChessCoordinate& x) const;
 
+            // throws IllegalMoveError if xy is not in move_list
             void move(const coordinate_container& move_list, const ChessNotation& xy);
 
+            // play move if it is legal, return why it is not otherwise, never throws on bad moves
+            MoveError try_move(const ChessNotation& move);
+
             bool is_castle(const cbn::ChessNotation& move) const;
 
             bool is_enemy(const cbn::ChessCoordinate& l1, const cbn::ChessCoordinate& l2) const;
 
             bool passant_is_legal(const cbn::ChessCoordinate& location, const cbn::ChessCoordinate& square) const;
 
-            Piece_color& colors_turn();
+            const Piece_color& colors_turn() const;
+
+            void pass_turn();
 
             bool is_checked(const Piece_color& color);
 
@@ -45,40 +88,149 @@ namespace cbn
 
             bool is_game_over(const Piece_color& color);
 
+            bool has_any_legal_move(const Piece_color& color);
+
+            bool is_draw();
+
+            bool is_repetition(int count) const;
+
+            // record the position a move reached, irreversible moves and null moves start a new repetition window
+            void push_position(bool irreversible, bool null_move = false);
+
+            // forget the position recorded last and go back to the clocks before it
+            void pop_position();
+
+            bool insufficient_material() const;
+
             notation_container& get_history();
 
             bool only_contains(const Piece_type& type);
 
+            bool has_non_pawn_material(const Piece_color& color) const;
+
+            int piece_count(const Piece_color& color, const Piece_type& type) const;
+
+            chess_square::square_mask occupancy() const;
+
+            // return squares of the pieces of both colors attacking square if only the squares of occupied held pieces
+            // removing a piece from occupied reveals the slider behind it (x-ray), pieces outside occupied never attack
+            chess_square::square_mask attackers_to(chess_square::Square square, chess_square::square_mask occupied) const;
+
+            bool castling_right(const ChessCoordinate& rook_location) const;
+
+            const MoveRights& move_rights() const;
+
+            // return rights left after move, a double step of moving leaves its pawn to be taken en passant
+            MoveRights rights_after(const ChessNotation& move, const Piece& moving) const;
+
+            // the position key follows the rights
+            void set_rights(const MoveRights& new_rights);
+
+            std::string fen() const;
+
         private:
+            void play(const ChessNotation& move);
+
             void move_piece(const ChessNotation& move);
 
+            zobrist::key_type compute_hash() const;
+
+            zobrist::key_type compute_pawn_hash() const;
+
+            // return part of the position key given by the castling rights and the en passant pawn
+            zobrist::key_type rights_key() const;
+
+            void count_pieces();
+
+            // make the current position the only one recorded
+            void start_key_history();
+
             bn::Board<container_type, Piece, allocator_type> board{DEFAULT_CHESS_BOARD};
+            zobrist::key_type position_key = 0;    // zobrist key over all pieces, the moving color and the rights
+            zobrist::key_type pawn_key = 0;    // zobrist key over pawns only, updated by place()
+            std::array<std::array<std::uint8_t, PIECE_TYPE_COUNT>, 2> material{};   // pieces on the board per [color][type], updated by place()
+            chess_square::square_mask occupied = 0;    // squares holding a piece, updated by place()
             notation_container move_history;
             Piece_color moving_turn{Piece_color::White};
             std::size_t last_change = 0;   // notations since last state change -- if 100 --> draw
+            int repetition_window = 0;     // plies back to the last irreversible or null move, earlier positions can not repeat
+
+            struct KeyEntry
+            {
+                zobrist::key_type key;
+                std::uint16_t last_change;
+                std::uint16_t repetition_window;
+            };
+
+            // keys of the positions along the game and the search path, entry key_count - 1 is the current position
+            std::array<KeyEntry, KEY_HISTORY_SIZE> key_history;
+            std::size_t key_count = 0;
+
+            // castling rights are taken away by every move from or onto the square of a king or rook
+            MoveRights rights;
+            int ply_offset = 0;     // plies played before move_history started, counts the FEN move number
     };
 
     class TemporalMove{
         public:
             TemporalMove(ChessBoard& b, const ChessNotation& m)
-                :board(b), move(m), temp_to(board[move.to])
+                :board(b), move(m), temp_from(board[move.from]), temp_to(board[move.to]), temp_rights(board.move_rights())
             {
+                counters::count<counters::Counter::TemporalMoves>();
+
+                // the passed pawn is not taken off by a temporal move --> no en passant is left to the enemy
+                MoveRights next_rights = board.rights_after(move, temp_from);
+                next_rights.passant_pawn = ChessCoordinate{};
+
                 // move pieces
-                board[move.to] = board[move.from];
-                board[move.from] = EMPTY_SQUARE;
-                board.colors_turn() = enemy_color.at(board.colors_turn());
+                board.place(move.to, promoted(temp_from, move.to));
+                board.place(move.from, EMPTY_SQUARE);
+                board.set_rights(next_rights);
+                board.pass_turn();
+                board.push_position(temp_from.type == Piece_type::Pawn || temp_to.type != Piece_type::Empty);
             }
             ~TemporalMove()
             {
                 // restore previous state
-                board[move.from] = board[move.to];
-                board[move.to] = temp_to;
-                board.colors_turn() = enemy_color.at(board.colors_turn());
+                board.pop_position();
+                board.place(move.from, temp_from);
+                board.place(move.to, temp_to);
+                board.set_rights(temp_rights);
+                board.pass_turn();
             }
         private:
             ChessBoard& board;
             const ChessNotation& move;
+            const Piece temp_from{};
             const Piece temp_to{};        
+            const MoveRights temp_rights;
+    };
+
+    class NullMove{
+        // pass the turn to the enemy without moving any piece
+        public:
+            NullMove(ChessBoard& b)
+                :board(b), temp_rights(board.move_rights())
+            {
+                counters::count<counters::Counter::NullMoves>();
+
+                // passing ends the chance to take en passant
+                MoveRights next_rights = temp_rights;
+                next_rights.passant_pawn = ChessCoordinate{};
+
+                board.set_rights(next_rights);
+                board.pass_turn();
+                board.push_position(false, true);
+            }
+            ~NullMove()
+            {
+                board.pop_position();
+                board.set_rights(temp_rights);
+                board.pass_turn();
+            }
+        private:
+            ChessBoard& board;
+            const MoveRights temp_rights;
     };
 
     /****************************************************Function declaration************************************************************************************/
@@ -90,10 +242,6 @@ namespace cbn
 
     // return true if movement.from is in move_list --> the move is legal
     bool move_is_legal(const coordinate_container& move_list, const ChessNotation& movement);
-
-    cbn::coordinate_container coordinates_between_xy(cbn::ChessCoordinate x, const cbn::ChessCoordinate& y);
-
-    bool coordinates_are_empty(const cbn::ChessBoard& board, const cbn::coordinate_container& c);
 }
 
 /**************************************************************************************Function definition*******************************************************************/
@@ -119,6 +267,235 @@ bool cbn::ChessBoard::only_contains(const Piece_type& type)
     return true;
 }
 
+bool cbn::ChessBoard::castling_right(const ChessCoordinate& rook_location) const
+// return true if the king may still castle with the rook starting on rook_location
+{
+    const int color = (rook_location.integer == WHITE_BACK_RANK) ? 0 : 1;
+    const int side = (rook_location.character == LEFT_ROOK_CHARACTER) ? 0 : 1;
+    const ChessCoordinate king_location{KING_CHARACTER, rook_location.integer};
+
+    if (!rights.castling[color][side])
+        return false;
+    if (piece_was_moved(king_location) || piece_was_moved(rook_location))
+        return false;
+
+    const Piece& king = operator[](king_location);
+    const Piece& rook = operator[](rook_location);
+    return king.type == Piece_type::King && rook.type == Piece_type::Rook && king.color == rook.color;
+}
+
+const cbn::MoveRights& cbn::ChessBoard::move_rights() const
+{
+    return rights;
+}
+
+cbn::MoveRights cbn::ChessBoard::rights_after(const ChessNotation& move, const Piece& moving) const
+{
+    MoveRights next = rights;
+
+    // a king or rook leaving its starting square or a rook taken on it ends the castling it takes part in
+    for (const ChessCoordinate& square : {move.from, move.to})
+    {
+        if (square.integer != WHITE_BACK_RANK && square.integer != BLACK_BACK_RANK)
+            continue;
+
+        auto& castling = next.castling[(square.integer == WHITE_BACK_RANK) ? 0 : 1];
+        if (square.character == KING_CHARACTER)
+            castling = {false, false};
+        else if (square.character == LEFT_ROOK_CHARACTER)
+            castling[0] = false;
+        else if (square.character == RIGHT_ROOK_CHARACTER)
+            castling[1] = false;
+    }
+
+    const bool double_step = moving.type == Piece_type::Pawn && abs(move.from.integer - move.to.integer) == 2;
+    next.passant_pawn = double_step ? move.to : ChessCoordinate{};
+    return next;
+}
+
+void cbn::ChessBoard::set_rights(const MoveRights& new_rights)
+{
+    position_key ^= rights_key();
+    rights = new_rights;
+    position_key ^= rights_key();
+}
+
+std::string cbn::ChessBoard::fen() const
+// return FEN of the position
+{
+    std::ostringstream os;
+
+    for (int row_i = 0; row_i < CHESS_BOARD_SIZE; ++row_i)
+    {
+        int empty_squares = 0;
+        for (int piece_i = 0; piece_i < CHESS_BOARD_SIZE; ++piece_i)
+        {
+            const auto& piece = operator[](ChessCoordinate{piece_i, row_i});
+            if (is_empty(piece))
+            {
+                ++empty_squares;
+                continue;
+            }
+
+            if (empty_squares > 0)
+                os << empty_squares;
+            empty_squares = 0;
+            os << piece_letter(piece);
+        }
+
+        if (empty_squares > 0)
+            os << empty_squares;
+        if (row_i != CHESS_BOARD_SIZE - 1)
+            os << '/';
+    }
+
+    os << (moving_turn == Piece_color::White ? " w " : " b ");
+
+    std::string castling;
+    if (castling_right({RIGHT_ROOK_CHARACTER, WHITE_BACK_RANK}))
+        castling += 'K';
+    if (castling_right({LEFT_ROOK_CHARACTER, WHITE_BACK_RANK}))
+        castling += 'Q';
+    if (castling_right({RIGHT_ROOK_CHARACTER, BLACK_BACK_RANK}))
+        castling += 'k';
+    if (castling_right({LEFT_ROOK_CHARACTER, BLACK_BACK_RANK}))
+        castling += 'q';
+    os << (castling.empty() ? "-" : castling) << ' ';
+
+    // square passed by a pawn double step, white pawns move towards row 0
+    if (rights.passant_pawn.is_valid())
+    {
+        const int direction = (operator[](rights.passant_pawn).color == Piece_color::White) ? -1 : 1;
+        os << square_name({rights.passant_pawn.character, rights.passant_pawn.integer - direction});
+    }
+    else
+        os << '-';
+
+    os << ' ' << last_change << ' ' << (ply_offset + static_cast<int>(move_history.size())) / 2 + 1;
+    return os.str();
+}
+
+bool cbn::ChessBoard::has_non_pawn_material(const Piece_color& color) const
+// return true if color owns any piece besides pawns and the king
+{
+    return piece_count(color, Piece_type::Rook) + piece_count(color, Piece_type::Knight)
+         + piece_count(color, Piece_type::Bishop) + piece_count(color, Piece_type::Queen) > 0;
+}
+
+chess_square::square_mask cbn::ChessBoard::occupancy() const
+{
+    return occupied;
+}
+
+chess_square::square_mask cbn::ChessBoard::attackers_to(chess_square::Square square, chess_square::square_mask occupied) const
+// steppers are found with one table lookup each, sliders as the nearest occupied square of every ray leaving square
+{
+    using namespace chess_square;
+
+    square_mask attackers = 0;
+    auto add_if = [&](square_mask candidates, auto is_attacker)
+    {
+        for (; candidates != 0; candidates &= candidates - 1)
+        {
+            const Square from{static_cast<std::uint8_t>(__builtin_ctzll(candidates))};
+            if (is_attacker(operator[](to_coordinate(from))))
+                attackers |= bit(from);
+        }
+    };
+
+    add_if(KNIGHT_STEPS[square.index] & occupied, [](const Piece& piece){ return piece.type == Piece_type::Knight; });
+    add_if(KING_STEPS[square.index] & occupied, [](const Piece& piece){ return piece.type == Piece_type::King; });
+
+    // white pawns move towards integer 0 --> they take on square from the squares a pawn moving up would take on
+    add_if(PAWN_STEPS[1][square.index] & occupied, [](const Piece& piece){ return piece.type == Piece_type::Pawn && piece.color == Piece_color::White; });
+    add_if(PAWN_STEPS[0][square.index] & occupied, [](const Piece& piece){ return piece.type == Piece_type::Pawn && piece.color == Piece_color::Black; });
+
+    for (int direction = 0; direction < static_cast<int>(DIRECTIONS.size()); ++direction)
+    {
+        const square_mask blockers = RAY[direction][square.index] & occupied;
+        if (blockers == 0)
+            continue;
+
+        const square_mask nearest = ascending(direction) ? (blockers & (~blockers + 1)) : (square_mask{1} << (SQUARE_COUNT - 1 - __builtin_clzll(blockers)));
+        const bool straight = is_straight(direction);
+        add_if(nearest, [straight](const Piece& piece){
+            return piece.type == Piece_type::Queen || piece.type == (straight ? Piece_type::Rook : Piece_type::Bishop);
+        });
+    }
+
+    return attackers;
+}
+
+int cbn::ChessBoard::piece_count(const Piece_color& color, const Piece_type& type) const
+// return number of pieces of type and color on the board
+{
+    return material[color == Piece_color::White ? 0 : 1][static_cast<int>(type)];
+}
+
+bool cbn::ChessBoard::insufficient_material() const
+// return true if no sequence of moves can mate --> K vs K, KB vs K or KN vs K
+{
+    for (const Piece_color color : {Piece_color::White, Piece_color::Black})
+    {
+        if (piece_count(color, Piece_type::Pawn) + piece_count(color, Piece_type::Rook) + piece_count(color, Piece_type::Queen) > 0)
+            return false;
+    }
+
+    const int minor_pieces = piece_count(Piece_color::White, Piece_type::Knight) + piece_count(Piece_color::White, Piece_type::Bishop)
+                           + piece_count(Piece_color::Black, Piece_type::Knight) + piece_count(Piece_color::Black, Piece_type::Bishop);
+    return minor_pieces <= 1;
+}
+
+bool cbn::ChessBoard::is_draw()
+// return true if the position is drawn whatever the moving color can play
+// a mate given with the move reaching the fifty move limit still wins
+{
+    if (insufficient_material() || is_repetition(2))
+        return true;
+
+    return last_change >= 100 && (!is_checked(moving_turn) || has_any_legal_move(moving_turn));
+}
+
+bool cbn::ChessBoard::is_repetition(int count) const
+// return true if the position occurred count times before
+// only every other entry has the same color at move, the window ends at the last irreversible move
+{
+    const int window = std::min({repetition_window, static_cast<int>(key_count) - 1, KEY_HISTORY_SIZE - 1});
+    int found = 0;
+
+    for (int distance = 4; distance <= window; distance += 2)
+    {
+        if (key_history[(key_count - 1 - distance) % KEY_HISTORY_SIZE].key == position_key && ++found >= count)
+            return true;
+    }
+    return false;
+}
+
+void cbn::ChessBoard::push_position(bool irreversible, bool null_move)
+{
+    if (irreversible)
+        last_change = 0;
+    else if (!null_move)
+        ++last_change;
+    repetition_window = (irreversible || null_move) ? 0 : repetition_window + 1;
+
+    key_history[key_count++ % KEY_HISTORY_SIZE] = KeyEntry{position_key, static_cast<std::uint16_t>(last_change), static_cast<std::uint16_t>(repetition_window)};
+}
+
+void cbn::ChessBoard::pop_position()
+{
+    const KeyEntry& previous = key_history[(--key_count - 1) % KEY_HISTORY_SIZE];
+    last_change = previous.last_change;
+    repetition_window = previous.repetition_window;
+}
+
+void cbn::ChessBoard::start_key_history()
+{
+    repetition_window = 0;
+    key_count = 0;
+    key_history[key_count++] = KeyEntry{position_key, static_cast<std::uint16_t>(last_change), 0};
+}
+
 cbn::notation_container& cbn::ChessBoard::get_history()
 {
     return move_history;
@@ -143,16 +520,208 @@ std::ostream& cbn::operator<<(std::ostream& os, const cbn::ChessBoard& cb)
     return os << "\n";
 }
 
+cbn::ChessBoard::ChessBoard()
+{
+    position_key = compute_hash();
+    pawn_key = compute_pawn_hash();
+    count_pieces();
+    start_key_history();
+}
+
+cbn::ChessBoard::ChessBoard(const std::string& fen)
+// read position of fen, an EPD works as well as its operations are ignored
+{
+    std::istringstream is{fen};
+    std::string placement, color, castling, passant, halfmove, fullmove;
+
+    if (!(is >> placement >> color >> castling >> passant))
+        throw BadFenError;
+    is >> halfmove >> fullmove;
+
+    // board starts empty, ranks of placement go from black back rank to white back rank
+    board = bn::Board<container_type, Piece, allocator_type>(CHESS_BOARD_SIZE, CHESS_BOARD_SIZE, EMPTY_SQUARE);
+
+    int row_i = 0;
+    int piece_i = 0;
+    for (char letter : placement)
+    {
+        if (letter == '/')
+        {
+            if (piece_i != CHESS_BOARD_SIZE)
+                throw BadFenError;
+            ++row_i;
+            piece_i = 0;
+        }
+        else if (std::isdigit(static_cast<unsigned char>(letter)))
+            piece_i += letter - '0';
+        else
+        {
+            if (row_i >= CHESS_BOARD_SIZE || piece_i >= CHESS_BOARD_SIZE)
+                throw BadFenError;
+            board[row_i][piece_i++] = piece_from_letter(letter);
+        }
+
+        if (piece_i > CHESS_BOARD_SIZE)
+            throw BadFenError;
+    }
+    if (row_i != CHESS_BOARD_SIZE - 1 || piece_i != CHESS_BOARD_SIZE)
+        throw BadFenError;
+
+    if (color == "b")
+        moving_turn = Piece_color::Black;
+    else if (color != "w")
+        throw BadFenError;
+
+    rights.castling = {{{false, false}, {false, false}}};
+    for (char letter : castling)
+    {
+        switch (letter)
+        {
+            case 'K': rights.castling[0][1] = true; break;
+            case 'Q': rights.castling[0][0] = true; break;
+            case 'k': rights.castling[1][1] = true; break;
+            case 'q': rights.castling[1][0] = true; break;
+            case '-': break;
+            default: throw BadFenError;
+        }
+    }
+
+    // the passed square lies behind the pawn that did the double step
+    if (passant != "-")
+    {
+        const ChessCoordinate target = square_from_name(passant);
+        if (!target.is_valid())
+            throw BadFenError;
+
+        // white pawns move towards row 0
+        const int direction = (moving_turn == Piece_color::Black) ? -1 : 1;
+        rights.passant_pawn = ChessCoordinate{target.character, target.integer + direction};
+    }
+
+    auto is_number = [](const std::string& text){
+        return !text.empty() && std::all_of(text.begin(), text.end(), [](char c){ return std::isdigit(static_cast<unsigned char>(c)); });
+    };
+
+    if (is_number(halfmove))
+        last_change = std::stoul(halfmove);
+
+    const int move_number = is_number(fullmove) ? std::max(1, std::stoi(fullmove)) : 1;
+    ply_offset = 2 * (move_number - 1) + (moving_turn == Piece_color::Black ? 1 : 0) - static_cast<int>(move_history.size());
+
+    position_key = compute_hash();
+    pawn_key = compute_pawn_hash();
+    count_pieces();
+    start_key_history();
+}
+
 void cbn::ChessBoard::restore()
 {
     board = DEFAULT_CHESS_BOARD;
     moving_turn = Piece_color::White;
     last_change = 0;
+    rights = MoveRights{};
+    ply_offset = 0;
+    position_key = compute_hash();
+    pawn_key = compute_pawn_hash();
+    count_pieces();
+    start_key_history();
 }
 
-cbn::Piece& cbn::ChessBoard::operator[](const cbn::ChessCoordinate& location)
+void cbn::ChessBoard::place(const cbn::ChessCoordinate& location, const cbn::Piece& piece)
+// put piece on location and keep the keys in sync
 {
-    return board[location.integer][location.character];
+    Piece& square = board[location.integer][location.character];
+
+    position_key ^= zobrist::piece_key(square, location);
+    position_key ^= zobrist::piece_key(piece, location);
+    pawn_key ^= zobrist::pawn_key(square, location);
+    pawn_key ^= zobrist::pawn_key(piece, location);
+
+    if (!is_empty(square))
+        --material[square.color == Piece_color::White ? 0 : 1][static_cast<int>(square.type)];
+    if (!is_empty(piece))
+        ++material[piece.color == Piece_color::White ? 0 : 1][static_cast<int>(piece.type)];
+
+    const chess_square::square_mask square_bit = chess_square::bit(chess_square::to_square(location));
+    occupied = is_empty(piece) ? (occupied & ~square_bit) : (occupied | square_bit);
+
+    square = piece;
+}
+
+zobrist::key_type cbn::ChessBoard::hash() const
+{
+    return position_key;
+}
+
+zobrist::key_type cbn::ChessBoard::pawn_hash() const
+{
+    return pawn_key;
+}
+
+zobrist::key_type cbn::ChessBoard::compute_hash() const
+// return position key computed from scratch
+{
+    zobrist::key_type key = (moving_turn == Piece_color::Black) ? zobrist::BLACK_TO_MOVE_KEY : 0;
+    key ^= rights_key();
+
+    for (int row_i = 0; row_i < CHESS_BOARD_SIZE; ++row_i)
+    {
+        for (int piece_i = 0; piece_i < CHESS_BOARD_SIZE; ++piece_i)
+        {
+            ChessCoordinate current{piece_i, row_i};
+            key ^= zobrist::piece_key(operator[](current), current);
+        }
+    }
+    return key;
+}
+
+zobrist::key_type cbn::ChessBoard::compute_pawn_hash() const
+// return pawn key computed from scratch
+{
+    zobrist::key_type key = 0;
+
+    for (int row_i = 0; row_i < CHESS_BOARD_SIZE; ++row_i)
+    {
+        for (int piece_i = 0; piece_i < CHESS_BOARD_SIZE; ++piece_i)
+        {
+            ChessCoordinate current{piece_i, row_i};
+            key ^= zobrist::pawn_key(operator[](current), current);
+        }
+    }
+    return key;
+}
+
+zobrist::key_type cbn::ChessBoard::rights_key() const
+{
+    zobrist::key_type key = 0;
+
+    for (int color = 0; color < 2; ++color)
+        for (int side = 0; side < 2; ++side)
+            if (rights.castling[color][side])
+                key ^= zobrist::castling_key(color, side);
+
+    if (rights.passant_pawn.is_valid())
+        key ^= zobrist::PASSANT_KEYS[rights.passant_pawn.character];
+    return key;
+}
+
+void cbn::ChessBoard::count_pieces()
+// count pieces and collect their squares from scratch
+{
+    material = {};
+    occupied = 0;
+
+    for (int row_i = 0; row_i < CHESS_BOARD_SIZE; ++row_i)
+    {
+        for (int piece_i = 0; piece_i < CHESS_BOARD_SIZE; ++piece_i)
+        {
+            const Piece& piece = operator[](ChessCoordinate{piece_i, row_i});
+            if (is_empty(piece))
+                continue;
+            ++material[piece.color == Piece_color::White ? 0 : 1][static_cast<int>(piece.type)];
+            occupied |= chess_square::bit(chess_square::make_square(piece_i, row_i));
+        }
+    }
 }
 
 const cbn::Piece& cbn::ChessBoard::operator[](const cbn::ChessCoordinate& location) const
@@ -190,26 +759,51 @@ bool cbn::ChessBoard::piece_was_moved(const cbn::ChessCoordinate& x) const
     return false;
 }
 
-cbn::Piece_color& cbn::ChessBoard::colors_turn()
+const cbn::Piece_color& cbn::ChessBoard::colors_turn() const
 {
     return moving_turn;
 }
 
+void cbn::ChessBoard::pass_turn()
+// enemy is at move now
+{
+    moving_turn = enemy_color.at(moving_turn);
+    position_key ^= zobrist::BLACK_TO_MOVE_KEY;
+}
+
 /****************************************************************************************************************************************/
 
 namespace lmn
 {
+    enum class Generation
+    {
+        All, Captures, Quiets  // en passant counts as capture, castling as quiet move
+    };
+
     class Legalmoves
     {
         public:
             Legalmoves(cbn::ChessBoard& b)
                 :board(b)   {   }
             
-            // calculate all legal moves for piece at location
-            const cbn::coordinate_container& get_legal_moves(const cbn::ChessCoordinate& location);
+            // calculate all legal moves of kind for piece at location
+            const cbn::coordinate_container& get_legal_moves(const cbn::ChessCoordinate& location, const Generation& kind = Generation::All);
             const cbn::coordinate_container& get_potential_moves(const cbn::ChessCoordinate& location);
+
+            // Pre-Condition: get_legal_moves was called for a piece of the moving color in the current position
+            bool is_attacked_by_enemy(const cbn::ChessCoordinate& location) const;
+
+            // return true if color can move at all, stops at the first legal move found
+            bool has_any_legal_move(const cbn::Piece_color& color);
         
         private:
+            void append_move(const cbn::ChessCoordinate& destination, bool capture);
+
+            // return true if piece at location may move to destination, masks have to be computed for its color
+            bool destination_is_legal(const cbn::ChessCoordinate& location, const cbn::ChessCoordinate& destination);
+
+            bool has_legal_destination(const cbn::ChessCoordinate& location);
+
             void append_legalmoves_pawn(const cbn::ChessCoordinate& location, const int offset_x, const int offset_y);
             void append_legalmoves_pawn_eating(const cbn::ChessCoordinate& location, std::initializer_list<cbn::ChessCoordinate> list);
             void append_en_passant(const cbn::ChessCoordinate& location, const int offset_x, const int offset_y);
@@ -222,11 +816,46 @@ namespace lmn
             
             void append_legalmoves_king(const cbn::ChessCoordinate& location, const int offset_x, const int offset_y);
             void append_castling(const cbn::ChessCoordinate& location, const cbn::ChessCoordinate& rook_location);
+
+            using square_mask = chess_square::square_mask;
+
+            void compute_masks(const cbn::Piece_color& color);
+            square_mask attacked_squares(const cbn::ChessCoordinate& location, const cbn::ChessCoordinate& transparent) const;
+
+            bool king_move_is_legal(const cbn::ChessCoordinate& location, const cbn::ChessCoordinate& destination) const;
+            bool en_passant_is_legal(const cbn::ChessCoordinate& location, const cbn::ChessCoordinate& destination);
             
             cbn::ChessBoard& board;
             cbn::coordinate_container move_list;
+            Generation generation{Generation::All};   // kind of moves the append functions keep
+
+            // masks of the position they were computed for, see compute_masks()
+            zobrist::key_type masks_key = 0;
+            cbn::Piece_color masks_color{cbn::Piece_color::Neutral};
+            square_mask enemy_attacks = 0;  // squares attacked by the enemy, sliders see through the king
+            square_mask check_mask = 0;     // destinations that stop a check, all squares if not checked
+            int checkers = 0;               // enemy pieces checking the king
+            cbn::ChessCoordinate king_location;    // invalid if the color has no king
+            std::array<square_mask, cbn::CHESS_BOARD_SIZE * cbn::CHESS_BOARD_SIZE> pin_mask{};  // line a pinned piece may not leave, all squares if not pinned
     };
 
+    const std::uint64_t ALL_SQUARES = ~std::uint64_t{0};
+
+    // {offset_x, offset_y} steps of every piece, in the order their moves are generated
+    const std::array<std::pair<int,int>, 4> ROOK_DIRECTIONS{{ {0, 1}, {0, -1}, {1, 0}, {-1, 0} }};
+    const std::array<std::pair<int,int>, 4> BISHOP_DIRECTIONS{{ {1, 1}, {1, -1}, {-1, 1}, {-1, -1} }};
+    const std::array<std::pair<int,int>, 8> KNIGHT_OFFSETS{{ {2, 1}, {2, -1}, {-2, 1}, {-2, -1}, {1, 2}, {1, -2}, {-1, 2}, {-1, -2} }};
+    const std::array<std::pair<int,int>, 8> KING_OFFSETS{{ {1, 1}, {1, -1}, {-1, 1}, {-1, -1}, {1, 0}, {-1, 0}, {0, 1}, {0, -1} }};
+
+    // kinds of pieces from the most to the least likely to have a legal move, the king is tried before them
+    const std::array<cbn::Piece_type, 5> MOBILITY_ORDER{ cbn::Piece_type::Queen, cbn::Piece_type::Knight, cbn::Piece_type::Rook,
+                                                         cbn::Piece_type::Bishop, cbn::Piece_type::Pawn };
+
+    std::uint64_t square_bit(const cbn::ChessCoordinate& location)
+    {
+        return chess_square::bit(chess_square::to_square(location));
+    }
+
     cbn::container_type<std::pair<int,int>, cbn::allocator_type<std::pair<int,int>>> generate_mixes(int i1, int i2);
 };
 
@@ -244,16 +873,6 @@ bool cbn::ChessBoard::is_castle(const cbn::ChessNotation& move) const
 }
 
 
-bool cbn::coordinates_are_empty(const cbn::ChessBoard& board, const cbn::coordinate_container& c)
-{
-    for (const auto& x : c)
-    {
-        if (!cbn::is_empty(board[x]))
-            return false;
-    }
-    return true;
-}
-
 bool cbn::ChessBoard::passant_is_legal(const cbn::ChessCoordinate& location, const cbn::ChessCoordinate& square) const
 // return true if an en passant move is legal
 // location is the current piece, square is the piece left or right of it
@@ -268,14 +887,15 @@ bool cbn::ChessBoard::passant_is_legal(const cbn::ChessCoordinate& location, con
     if (operator[](location).type != operator[](square).type) // need to be of same type
         return false;
 
-    // same character rank and move difference is 2
-    if (last_move().from.character != last_move().to.character)
+    if (operator[](location).type != Piece_type::Pawn)
         return false;
-    if (abs(last_move().from.integer - last_move().to.integer) != 2)
+
+    // only the pawn that just did a double step can be taken, it stands beside location
+    if (square != rights.passant_pawn || square.integer != location.integer)
         return false;
-    
+
     // need to be close to each other
-    if (abs(last_move().to.character - location.character) != 1)
+    if (abs(square.character - location.character) != 1)
         return false;
 
     return true;
@@ -308,10 +928,10 @@ void lmn::Legalmoves::append_legalmoves_pawn(const cbn::ChessCoordinate& locatio
 
     if (cbn::is_empty(board[front]))
     {
-        move_list.push_back(front);
+        append_move(front, false);
         
         if (location.integer == starting_row && cbn::is_empty(board[front_2]))    // pawns on starting row can move 2 squares
-            move_list.push_back(front_2);
+            append_move(front_2, false);
     }
 
     // Check for eating other pieces
@@ -333,7 +953,7 @@ void lmn::Legalmoves::append_legalmoves_pawn_eating(const cbn::ChessCoordinate&
             continue;
 
         if (!cbn::is_empty(board[square]) && board.is_enemy(location, square))
-            move_list.push_back(square);
+            append_move(square, true);
     }
     return;
 }
@@ -354,14 +974,12 @@ void lmn::Legalmoves::append_en_passant(const cbn::ChessCoordinate& location, co
 
         cbn::ChessCoordinate en_passant_coordinate;
 
-        const cbn::ChessNotation& last_move = board.last_move();
-
         if (board[location].color == cbn::Piece_color::White)
             en_passant_coordinate = square + cbn::ChessCoordinate{0, -offset_y};  // move up from last move
         else
             en_passant_coordinate = square + cbn::ChessCoordinate{0, offset_y};   // move down from last move
 
-        move_list.push_back(en_passant_coordinate);
+        append_move(en_passant_coordinate, true);
     }
 
     return;
@@ -375,13 +993,13 @@ void lmn::Legalmoves::append_legalmoves_rook(const cbn::ChessCoordinate& locatio
     {
         // can go to empty coordinates
         if (cbn::is_empty(board[current]))
-            move_list.push_back(current);
+            append_move(current, false);
 
         // but if its an enemy -> break the loop
         else
         {
             if (board.is_enemy(location, current))
-                move_list.push_back(current);
+                append_move(current, true);
             break;
         }
 
@@ -399,7 +1017,7 @@ void lmn::Legalmoves::append_knight_move(const cbn::ChessCoordinate& location, c
         return;
 
     if (cbn::is_empty(board[current]) || board.is_enemy(location, current))
-        move_list.push_back(current);
+        append_move(current, !cbn::is_empty(board[current]));
 
     return;
 }
@@ -412,13 +1030,13 @@ void lmn::Legalmoves::append_bishop_diagonal(const cbn::ChessCoordinate& locatio
     {
         // can go to empty coordinates
         if (cbn::is_empty(board[diagonal]))
-            move_list.push_back(diagonal);
+            append_move(diagonal, false);
 
         // but if its an enemy -> break the loop
         else
         {
             if (board.is_enemy(location, diagonal))
-                move_list.push_back(diagonal);
+                append_move(diagonal, true);
             break;
         }
 
@@ -436,7 +1054,7 @@ void lmn::Legalmoves::append_legalmoves_king(const cbn::ChessCoordinate& locatio
 
     // append if the square is empty or is an enemy
     if (cbn::is_empty(board[current]) || board.is_enemy(location, current))
-        move_list.push_back(current);
+        append_move(current, !cbn::is_empty(board[current]));
 
     return;
 }
@@ -444,12 +1062,10 @@ void lmn::Legalmoves::append_legalmoves_king(const cbn::ChessCoordinate& locatio
 void lmn::Legalmoves::append_castling(const cbn::ChessCoordinate& location, const cbn::ChessCoordinate& rook_location)
 // location is the king coordinate
 {
-    // Both pieces were not moved yet
-    if (board.piece_was_moved(location) || board.piece_was_moved(rook_location))
+    // Both pieces were not moved yet and the position allows it
+    if (board.piece_was_moved(location) || board.piece_was_moved(rook_location) || !board.castling_right(rook_location))
         return;
 
-    cbn::coordinate_container coordinates_between_pieces = cbn::coordinates_between_xy(rook_location, location);
-
     cbn::ChessCoordinate castle_location;
 
     if (rook_location.character == cbn::LEFT_ROOK_CHARACTER)
@@ -461,42 +1077,321 @@ void lmn::Legalmoves::append_castling(const cbn::ChessCoordinate& location, cons
         return;
 
     // no pieces between king and rook
-    if (cbn::coordinates_are_empty(board, coordinates_between_pieces))
-        move_list.push_back(castle_location);
+    if ((chess_square::between(chess_square::to_square(rook_location), chess_square::to_square(location)) & board.occupancy()) == 0)
+        append_move(castle_location, false);
 
     return;
 }
 
-const cbn::coordinate_container& lmn::Legalmoves::get_legal_moves(const cbn::ChessCoordinate& location)
+void lmn::Legalmoves::append_move(const cbn::ChessCoordinate& destination, bool capture)
+// append destination to move_list if it is of the requested kind
 {
-    move_list = cbn::coordinate_container{};
+    if ((generation == Generation::Captures && !capture) || (generation == Generation::Quiets && capture))
+        return;
+    move_list.push_back(destination);
+}
+
+bool lmn::Legalmoves::is_attacked_by_enemy(const cbn::ChessCoordinate& location) const
+{
+    return (enemy_attacks & square_bit(location)) != 0;
+}
+
+const cbn::coordinate_container& lmn::Legalmoves::get_legal_moves(const cbn::ChessCoordinate& location, const Generation& kind)
+// calculate all legal moves of kind for piece at location
+// pseudo legal moves are restricted with the pin and check masks of the position instead of trying them out
+{
+    counters::count<counters::Counter::LegalMoveQueries>();
+    move_list.clear();
+
+    generation = kind;
     get_potential_moves(location);
+    generation = Generation::All;
+
+    if (move_list.empty())
+        return move_list;
+
+    const cbn::Piece& piece = board[location];
+
+    if (masks_key != board.hash() || masks_color != piece.color)
+        compute_masks(piece.color);
 
-    for (auto iter = move_list.begin(); iter != move_list.end();)
+    auto is_illegal = [&](const cbn::ChessCoordinate& destination)
     {
-        cbn::ChessNotation move{location, *iter};
-        cbn::TemporalMove _{board, move};
-        if (board.is_checked(board[*iter].color))
-            move_list.erase(iter);
-        else
-            ++iter;
-    }
+        return !destination_is_legal(location, destination);
+    };
+
+    move_list.erase(std::remove_if(move_list.begin(), move_list.end(), is_illegal), move_list.end());
+    counters::count_generated(piece.type, move_list.size());
 
     std::sort(move_list.begin(), move_list.end());
     return move_list;
 }
 
+bool lmn::Legalmoves::destination_is_legal(const cbn::ChessCoordinate& location, const cbn::ChessCoordinate& destination)
+{
+    const cbn::Piece& piece = board[location];
+
+    if (piece.type == cbn::Piece_type::King)
+        return king_move_is_legal(location, destination);
+
+    // double check --> only the king can move
+    if (checkers > 1)
+        return false;
+
+    // pawn moving diagonally to an empty square captures en passant
+    if (piece.type == cbn::Piece_type::Pawn && destination.character != location.character && cbn::is_empty(board[destination]))
+        return en_passant_is_legal(location, destination);
+
+    return (check_mask & pin_mask[zobrist::square_index(location)] & square_bit(destination)) != 0;
+}
+
+bool lmn::Legalmoves::has_legal_destination(const cbn::ChessCoordinate& location)
+// pseudo legal moves of one piece are generated, none of them is sorted or removed
+{
+    move_list.clear();
+    get_potential_moves(location);
+
+    for (const auto& destination : move_list)
+    {
+        if (destination_is_legal(location, destination))
+            return true;
+    }
+    return false;
+}
+
+bool lmn::Legalmoves::has_any_legal_move(const cbn::Piece_color& color)
+// the king is tried first as it rarely is stuck unless the game is over,
+// then the other pieces from the most to the least mobile, the material counters skip absent kinds
+{
+    counters::count<counters::Counter::AnyLegalMoveTests>();
+
+    if (masks_key != board.hash() || masks_color != color)
+        compute_masks(color);
+
+    if (king_location.is_valid() && has_legal_destination(king_location))
+        return true;
+
+    // double check --> only the king can move
+    if (checkers > 1)
+        return false;
+
+    for (const cbn::Piece_type type : MOBILITY_ORDER)
+    {
+        if (board.piece_count(color, type) == 0)
+            continue;
+
+        int found = 0;
+        for (int rank_index = 0; rank_index < cbn::CHESS_BOARD_SIZE && found < board.piece_count(color, type); ++rank_index)
+        {
+            for (int piece_index = 0; piece_index < cbn::CHESS_BOARD_SIZE; ++piece_index)
+            {
+                const cbn::ChessCoordinate current{piece_index, rank_index};
+                const cbn::Piece& piece = board[current];
+
+                if (piece.type != type || piece.color != color)
+                    continue;
+                if (has_legal_destination(current))
+                    return true;
+                ++found;
+            }
+        }
+    }
+    return false;
+}
+
+void lmn::Legalmoves::compute_masks(const cbn::Piece_color& color)
+// compute enemy attacks, checks and pins against the king of color for the current position
+{
+    masks_key = board.hash();
+    masks_color = color;
+    enemy_attacks = 0;
+    check_mask = 0;
+    checkers = 0;
+    pin_mask.fill(ALL_SQUARES);
+
+    // one pass over the board finds the king and the enemy pieces
+    cbn::ChessCoordinate king;
+    std::array<cbn::ChessCoordinate, cbn::CHESS_BOARD_SIZE * cbn::CHESS_BOARD_SIZE> enemies;
+    int enemy_count = 0;
+
+    for (int rank_index = 0; rank_index < cbn::CHESS_BOARD_SIZE; ++rank_index)
+    {
+        for (int piece_index = 0; piece_index < cbn::CHESS_BOARD_SIZE; ++piece_index)
+        {
+            cbn::ChessCoordinate current{piece_index, rank_index};
+            const cbn::Piece& piece = board[current];
+
+            if (cbn::is_empty(piece))
+                continue;
+            if (piece.color != color)
+                enemies[enemy_count++] = current;
+            else if (piece.type == cbn::Piece_type::King)
+                king = current;
+        }
+    }
+    king_location = king;
+
+    if (!king.is_valid())
+    {
+        check_mask = ALL_SQUARES;
+        return;
+    }
+
+    const square_mask king_bit = square_bit(king);
+
+    // enemy attacks and the pieces checking the king
+    for (int enemy_index = 0; enemy_index < enemy_count; ++enemy_index)
+    {
+        const cbn::ChessCoordinate& current = enemies[enemy_index];
+
+        const square_mask attacks = attacked_squares(current, king);
+        enemy_attacks |= attacks;
+
+        if (attacks & king_bit)
+        {
+            ++checkers;
+            check_mask |= square_bit(current) | chess_square::between(chess_square::to_square(current), chess_square::to_square(king));
+        }
+    }
+
+    if (checkers == 0)
+        check_mask = ALL_SQUARES;
+
+    // pins --> an enemy slider on a line of the king with exactly one piece between them, that piece being own, pins it
+    const chess_square::Square king_square = chess_square::to_square(king);
+    const square_mask occupied = board.occupancy();
+
+    for (int enemy_index = 0; enemy_index < enemy_count; ++enemy_index)
+    {
+        const cbn::ChessCoordinate& current = enemies[enemy_index];
+        const cbn::Piece_type type = board[current].type;
+        const chess_square::Square slider = chess_square::to_square(current);
+        const int direction = chess_square::direction(king_square, slider);
+
+        const bool on_its_line = (direction != chess_square::NO_DIRECTION)
+            && ((chess_square::is_straight(direction) && (type == cbn::Piece_type::Rook || type == cbn::Piece_type::Queen))
+                || (chess_square::is_diagonal(direction) && (type == cbn::Piece_type::Bishop || type == cbn::Piece_type::Queen)));
+        if (!on_its_line)
+            continue;
+
+        const square_mask blockers = chess_square::between(king_square, slider) & occupied;
+        if (blockers == 0 || (blockers & (blockers - 1)) != 0)
+            continue;
+
+        const chess_square::Square pinned{static_cast<std::uint8_t>(__builtin_ctzll(blockers))};
+        if (board[chess_square::to_coordinate(pinned)].color == color)
+            pin_mask[pinned.index] = chess_square::between(king_square, slider) | chess_square::bit(slider);
+    }
+}
+
+lmn::Legalmoves::square_mask lmn::Legalmoves::attacked_squares(const cbn::ChessCoordinate& location, const cbn::ChessCoordinate& transparent) const
+// return squares attacked by the piece at location
+// sliding pieces see through transparent, so squares behind a king stay attacked
+{
+    const cbn::Piece& piece = board[location];
+    square_mask attacks = 0;
+
+    auto add_step = [&](int offset_x, int offset_y)
+    {
+        cbn::ChessCoordinate target = location + cbn::ChessCoordinate{offset_x, offset_y};
+        if (target.is_valid())
+            attacks |= square_bit(target);
+    };
+
+    auto add_ray = [&](int offset_x, int offset_y)
+    {
+        const cbn::ChessCoordinate step{offset_x, offset_y};
+        for (cbn::ChessCoordinate target = location + step; target.is_valid(); target += step)
+        {
+            attacks |= square_bit(target);
+            if (!cbn::is_empty(board[target]) && target != transparent)
+                break;
+        }
+    };
+
+    switch (piece.type)
+    {
+        case cbn::Piece_type::Pawn:
+        {
+            const int forward = (piece.color == cbn::Piece_color::White) ? -cbn::PAWN_OFFSET_Y : cbn::PAWN_OFFSET_Y;
+            add_step(-1, forward);
+            add_step(1, forward);
+            break;
+        }
+        case cbn::Piece_type::Knight:
+            for (const auto& [offset_x, offset_y] : KNIGHT_OFFSETS)
+                add_step(offset_x, offset_y);
+            break;
+        case cbn::Piece_type::King:
+            for (const auto& [offset_x, offset_y] : KING_OFFSETS)
+                add_step(offset_x, offset_y);
+            break;
+        case cbn::Piece_type::Rook:
+            for (const auto& [offset_x, offset_y] : ROOK_DIRECTIONS)
+                add_ray(offset_x, offset_y);
+            break;
+        case cbn::Piece_type::Bishop:
+            for (const auto& [offset_x, offset_y] : BISHOP_DIRECTIONS)
+                add_ray(offset_x, offset_y);
+            break;
+        case cbn::Piece_type::Queen:
+            for (const auto& [offset_x, offset_y] : ROOK_DIRECTIONS)
+                add_ray(offset_x, offset_y);
+            for (const auto& [offset_x, offset_y] : BISHOP_DIRECTIONS)
+                add_ray(offset_x, offset_y);
+            break;
+        default:
+            break;
+    }
+
+    return attacks;
+}
+
+bool lmn::Legalmoves::king_move_is_legal(const cbn::ChessCoordinate& location, const cbn::ChessCoordinate& destination) const
+// return true if the king does not move into an attacked square
+// castling also may not start in check or pass an attacked square
+{
+    if (enemy_attacks & square_bit(destination))
+        return false;
+
+    if (abs(destination.character - location.character) == cbn::CASTLE_OFFSET)
+    {
+        if (checkers > 0)
+            return false;
+
+        const cbn::ChessCoordinate passed{(location.character + destination.character) / 2, location.integer};
+        if (enemy_attacks & square_bit(passed))
+            return false;
+    }
+
+    return true;
+}
+
+bool lmn::Legalmoves::en_passant_is_legal(const cbn::ChessCoordinate& location, const cbn::ChessCoordinate& destination)
+// en passant removes two pieces from one rank, which pins cannot describe --> try it out
+{
+    const cbn::ChessCoordinate captured{destination.character, location.integer};
+    const cbn::Piece captured_pawn = board[captured];
+    const cbn::Piece_color color = board[location].color;
+    const cbn::ChessNotation move{location, destination, cbn::UNCHECKED};
+
+    bool legal;
+    board.place(captured, cbn::EMPTY_SQUARE);
+    {
+        cbn::TemporalMove _{board, move};
+        legal = !board.is_checked(color);
+    }
+    board.place(captured, captured_pawn);
+
+    return legal;
+}
+
 const cbn::coordinate_container& lmn::Legalmoves::get_potential_moves(const cbn::ChessCoordinate& location)
 // return a container containing all legal moves for kind located at location
 {
     if (board[location].type == cbn::Piece_type::Rook || board[location].type == cbn::Piece_type::Queen)
     {
-        // create pairs of all directions for rooks move
-        auto offsets = lmn::generate_mixes(cbn::ROOK_OFFSET_X, cbn::ROOK_OFFSET_Y);
-        auto extension = lmn::generate_mixes(cbn::ROOK_OFFSET_Y, cbn::ROOK_OFFSET_X);
-        offsets.insert(offsets.begin(), extension.begin(), extension.end());
-
-        for (const auto& [offset_x, offset_y] : offsets)
+        for (const auto& [offset_x, offset_y] : ROOK_DIRECTIONS)
         {
             append_legalmoves_rook(location, offset_x, offset_y);
         }
@@ -504,9 +1399,7 @@ const cbn::coordinate_container& lmn::Legalmoves::get_potential_moves(const cbn:
 
     if (board[location].type == cbn::Piece_type::Bishop || board[location].type == cbn::Piece_type::Queen)
     {
-        // create pairs of all directions for bishops move
-        auto offsets = lmn::generate_mixes(cbn::BISHOP_OFFSET, cbn::BISHOP_OFFSET);
-        for (const auto& [offset_x, offset_y] : offsets)
+        for (const auto& [offset_x, offset_y] : BISHOP_DIRECTIONS)
         {
             append_bishop_diagonal(location, offset_x, offset_y);
         }
@@ -519,25 +1412,13 @@ const cbn::coordinate_container& lmn::Legalmoves::get_potential_moves(const cbn:
 
     else if (board[location].type == cbn::Piece_type::Knight)
     {
-        // create pairs of all offsets for knight moves
-        auto offsets = lmn::generate_mixes(cbn::KNIGHT_OFFSET_LONG_SIDE, cbn::KNIGHT_OFFSET_SHORT_SIDE);
-        auto extension = lmn::generate_mixes(cbn::KNIGHT_OFFSET_SHORT_SIDE, cbn::KNIGHT_OFFSET_LONG_SIDE);
-        offsets.insert(offsets.end(), extension.begin(), extension.end());
-
-        for (const auto& [offset_x, offset_y] : offsets)
+        for (const auto& [offset_x, offset_y] : KNIGHT_OFFSETS)
             append_knight_move(location, offset_x, offset_y);
     }
 
     else if (board[location].type == cbn::Piece_type::King)
     {
-        // create pairs of all possible offsets for kings move
-        auto offsets = lmn::generate_mixes(cbn::KING_OFFSET_DIAGONAL, cbn::KING_OFFSET_DIAGONAL);
-        auto extension = lmn::generate_mixes(cbn::KING_OFFSET_DIAGONAL, cbn::KING_OFFSET_CROSSWAYS);
-        offsets.insert(offsets.end(), extension.begin(), extension.end());
-        extension = lmn::generate_mixes(cbn::KING_OFFSET_CROSSWAYS, cbn::KING_OFFSET_DIAGONAL);
-        offsets.insert(offsets.end(), extension.begin(), extension.end());
-
-        for (const auto& [offset_x, offset_y] : offsets)
+        for (const auto& [offset_x, offset_y] : KING_OFFSETS)
             append_legalmoves_king(location, offset_x, offset_y);
         
         cbn::ChessCoordinate left_rook, right_rook;
@@ -588,99 +1469,127 @@ bool cbn::ChessBoard::is_enemy(const cbn::ChessCoordinate& l1, const cbn::ChessC
     return operator[](l1).color != operator[](l2).color;
 }
 
-cbn::coordinate_container cbn::coordinates_between_xy(cbn::ChessCoordinate x, const cbn::ChessCoordinate& y)
-// return container all coordinates between x and y (without including them)
+/*************************Functions requiring Legalmoves and Chessboard****************************/
+
+void cbn::ChessBoard::move(const cbn::coordinate_container& move_list, const cbn::ChessNotation& move)
+// move a piece on the chess board from move.x to move.y
 {
-    cbn::coordinate_container coordinates{};
+    if (!move_is_legal(move_list, move))
+        throw cbn::IllegalMoveError;
+    play(move);
+}
 
-    while (x != y)
-    {
-        // move 1 closer on character axis
-        if (x.character > y.character)
-            x -= cbn::ChessCoordinate{1,0};
-        else if (x.character < y.character)
-            x += cbn::ChessCoordinate{1,0};
-        
-        // move 1 closer on 
-        if (x.integer > y.integer)
-            x -= cbn::ChessCoordinate{0,1};
-        else if (x.integer < y.integer)
-            x += cbn::ChessCoordinate{0,1};
+cbn::MoveError cbn::ChessBoard::try_move(const ChessNotation& move)
+// same as move() but every rejected move is reported instead of thrown
+{
+    if (!move.from.is_valid() || !move.to.is_valid() || move.from == move.to)
+        return MoveError::BadSquare;
+    if (is_empty(operator[](move.from)))
+        return MoveError::EmptySquare;
+    if (operator[](move.from).color != moving_turn)
+        return MoveError::WrongColor;
 
-        // otherwise equivalent of y will be added to the container
-        if (x != y)
-            coordinates.push_back(x);  
-    }
+    lmn::Legalmoves legal(*this);
+    if (!move_is_legal(legal.get_legal_moves(move.from), move))
+        return MoveError::Illegal;
 
-    return coordinates;
+    play(move);
+    return MoveError::None;
 }
 
-/*************************Functions requiring Legalmoves and Chessboard****************************/
-
-void cbn::ChessBoard::move(const cbn::coordinate_container& move_list, const cbn::ChessNotation& move)
-// move a piece on the chess board from move.x to move.y
+void cbn::ChessBoard::play(const ChessNotation& move)
+// Pre-Condition: move is legal
 {
-    if (move_is_legal(move_list, move))
+    // pawn moves and captures can not be undone --> fifty move counter starts again
+    const bool irreversible = operator[](move.from).type == Piece_type::Pawn || !is_empty(operator[](move.to));
+
+    // if en pessant
+    const ChessCoordinate passed = rights.passant_pawn;
+    if (passed.is_valid() && passant_is_legal(move.from, passed))
+    {
+        // if pawn moves diagonally
+        if (passed.character == move.to.character)
+            place(passed, EMPTY_SQUARE); // remove the last moved piece
+    }
+
+    set_rights(rights_after(move, operator[](move.from)));
+
+    if (is_castle(move))
     {
-        // if en pessant
-        if (!move_history.empty())
+        // move.to.ingeter and move.from.integer are same as the rank doesnt change for the piece
+
+        cbn::ChessNotation rook_move;
+        
+        // if left castle
+        if (move.to.character == cbn::LEFT_CASTLE_CHARACTER)
         {
-            auto last = last_move();    // need last move to check if en passant is legal
-            if (passant_is_legal(move.from, last.to))
+            rook_move =
             {
-                // if pawn moves diagonally
-                if (last.to.character == move.to.character)
-                    operator[](last.to) = EMPTY_SQUARE; // remove the last moved piece
-            }
+                {cbn::LEFT_ROOK_CHARACTER, move.to.integer},
+                {cbn::LEFT_CASTLE_CHARACTER + cbn::CASTLE_OFFSET / 2, move.to.integer},
+                UNCHECKED
+            };
         }
-
-        if (is_castle(move))
+        else    // right castle
         {
-            // move.to.ingeter and move.from.integer are same as the rank doesnt change for the piece
-
-            cbn::ChessNotation rook_move;
-            
-            // if left castle
-            if (move.to.character == cbn::LEFT_CASTLE_CHARACTER)
+            rook_move =
             {
-                rook_move =
-                {
-                    {cbn::LEFT_ROOK_CHARACTER, move.to.integer},
-                    {cbn::LEFT_CASTLE_CHARACTER + cbn::CASTLE_OFFSET / 2, move.to.integer}
-                };
-            }
-            else    // right castle
-            {
-                rook_move =
-                {
-                    {cbn::RIGHT_ROOK_CHARACTER, move.to.integer},
-                    {cbn::RIGHT_CASTLE_CHARACTER - cbn::CASTLE_OFFSET / 2, move.to.integer}
-                };
-            }
-            move_piece(rook_move);
+                {cbn::RIGHT_ROOK_CHARACTER, move.to.integer},
+                {cbn::RIGHT_CASTLE_CHARACTER - cbn::CASTLE_OFFSET / 2, move.to.integer},
+                UNCHECKED
+            };
         }
+        move_piece(rook_move);
+    }
 
-        move_piece(move);
+    move_piece(move);
 
-        // enemy is at move now
-        moving_turn = enemy_color.at(moving_turn);
-    }
-    else 
-        throw cbn::IllegalMoveError;
+    // enemy is at move now
+    pass_turn();
+    push_position(irreversible);
+}
+
+cbn::Piece cbn::promoted(const Piece& piece, const ChessCoordinate& destination)
+{
+    if (piece.type != Piece_type::Pawn)
+        return piece;
+
+    // white pawns move towards the black back rank and the other way around
+    if (piece.color == Piece_color::White && destination.integer == BLACK_BACK_RANK)
+        return WHITE_QUEEN;
+    if (piece.color == Piece_color::Black && destination.integer == WHITE_BACK_RANK)
+        return BLACK_QUEEN;
+
+    return piece;
+}
+
+char cbn::piece_letter(const Piece& piece)
+{
+    const char letter = PIECE_LETTERS[static_cast<int>(piece.type)];
+    return (piece.color == Piece_color::White) ? letter : std::tolower(letter);
+}
+
+cbn::Piece cbn::piece_from_letter(char letter)
+{
+    const auto type = PIECE_LETTERS.find(std::toupper(static_cast<unsigned char>(letter)));
+    if (type == std::string_view::npos)
+        throw BadFenError;
+
+    return std::isupper(static_cast<unsigned char>(letter)) ? WHITE_PIECES[type] : BLACK_PIECES[type];
 }
 
 void cbn::ChessBoard::move_piece(const ChessNotation& move)
 {
-    operator[](move.to) = operator[](move.from);
-    operator[](move.from)= EMPTY_SQUARE;
+    place(move.to, promoted(operator[](move.from), move.to));
+    place(move.from, EMPTY_SQUARE);
 
     move_history.push_back(move);
-    ++last_change;
 }
 
 bool cbn::ChessBoard::is_checked(const Piece_color& color)
 // return if color is checked
 {
+    counters::count<counters::Counter::CheckTests>();
     lmn::Legalmoves legal(*this);
 
     // iterate all pieces
@@ -718,37 +1627,14 @@ bool cbn::ChessBoard::move_is_unchecking(const cbn::ChessNotation& move)
 }
 
 bool cbn::ChessBoard::is_game_over(const cbn::Piece_color& color)
-// return if color has no legal moevs to do
+// return if the game is drawn or color has no legal moves to do
 {
-    if (last_change >= 100)
-    {
-        return true;
-    }
+    return is_draw() || !has_any_legal_move(color);
+}
 
+bool cbn::ChessBoard::has_any_legal_move(const cbn::Piece_color& color)
+{
     lmn::Legalmoves legal(*this);
-
-    if (only_contains(cbn::Piece_type::King))
-        return true;
-
-    // iterate all pieces
-    for (int row_i = 0; row_i < board.size(); ++row_i)
-    {
-        const auto& row = board[row_i];
-        for (int piece_i = 0; piece_i < row.size(); ++piece_i)
-        {
-            ChessCoordinate current{piece_i, row_i};
-            const auto& piece = operator[](current);
-
-            // check if enemy color
-            if (piece.color != color) 
-                continue;
-
-            const auto move_list = legal.get_legal_moves(current);
-            
-            if (move_list.size() > 0)
-                return false;
-        }
-    }
-    return true;
+    return legal.has_any_legal_move(color);
 }
 
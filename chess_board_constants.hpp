@@ -1,8 +1,11 @@
 #pragma once
 
+#include <array>
 #include <map>
 #include <string_view>
+#include <vector>
 
+#include "Arena.hpp"
 #include "Board.hpp"
 #include "Exception.hpp"
 
@@ -12,7 +15,7 @@ namespace chess_types
     using container_type = std::vector<T, A>;
         
     template <typename T>
-    using allocator_type = std::allocator<T>;
+    using allocator_type = arena::ArenaAllocator<T>;   // thread local arena while the search runs, global allocator otherwise
         
     using value_type = std::string_view;     // std::string because it is not bound to 1 byte of data --> no overflow
 }
@@ -55,6 +58,7 @@ namespace chess_constants
     const Exception IllegalMoveError{"IllegalMoveError: The Inputted Move Is Illegal To Do"};
     const Exception BadSequenceError{"BadSequenceError: This Color is Not At Move"};
     const Exception KingIsCheckedError{"KingIsCheckedError: The Inputted Move Is Illegal To Do"};
+    const Exception BadFenError{"BadFenError: The Position Can Not Be Read"};
 
     const std::map<helper_classes::Piece_color, helper_classes::Piece_color> enemy_color
     {
@@ -62,6 +66,8 @@ namespace chess_constants
     };
 
     const int CHESS_BOARD_SIZE = 8;
+    const int PIECE_TYPE_COUNT = 6;     // Piece_type without Empty
+    const int KEY_HISTORY_SIZE = 256;   // positions kept for repetitions, more than the fifty move rule and a search path span
     const helper_classes::Piece EMPTY_SQUARE{"□", helper_classes::Piece_type::Empty, helper_classes::Piece_color::Neutral};
 
     const helper_classes::Piece WHITE_KING{"♔", helper_classes::Piece_type::King, helper_classes::Piece_color::White};
@@ -78,6 +84,12 @@ namespace chess_constants
     const helper_classes::Piece BLACK_KNIGHT{"♞", helper_classes::Piece_type::Knight, helper_classes::Piece_color::Black};
     const helper_classes::Piece BLACK_PAWN{"♟", helper_classes::Piece_type::Pawn, helper_classes::Piece_color::Black};
 
+    // pieces indexed by Piece_type
+    const std::array<helper_classes::Piece, PIECE_TYPE_COUNT> WHITE_PIECES{ WHITE_PAWN, WHITE_ROOK, WHITE_KNIGHT, WHITE_BISHOP, WHITE_QUEEN, WHITE_KING };
+    const std::array<helper_classes::Piece, PIECE_TYPE_COUNT> BLACK_PIECES{ BLACK_PAWN, BLACK_ROOK, BLACK_KNIGHT, BLACK_BISHOP, BLACK_QUEEN, BLACK_KING };
+
+    const std::string_view PIECE_LETTERS = "PRNBQK";   // FEN and SAN letters indexed by Piece_type, black pieces use lower case in FEN
+
     const bn::Board<chess_types::container_type, helper_classes::Piece, chess_types::allocator_type>::row_type BLACK_PIECES_RANK{ BLACK_ROOK, BLACK_KNIGHT, BLACK_BISHOP, BLACK_QUEEN, 
                                                                                     BLACK_KING, BLACK_BISHOP, BLACK_KNIGHT, BLACK_ROOK };
 
@@ -114,6 +126,7 @@ namespace chess_constants
 
     const int LEFT_ROOK_CHARACTER = 0;
     const int RIGHT_ROOK_CHARACTER = 7;
+    const int KING_CHARACTER = 4;
 
     const int LEFT_CASTLE_CHARACTER = 2;
     const int RIGHT_CASTLE_CHARACTER = 6;
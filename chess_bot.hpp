@@ -1,9 +1,28 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <future>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 #include "chess_bot_constants.hpp"
 #include "chess_board.hpp"
+#include "chess_nnue.hpp"
+#include "chess_trace.hpp"
+#include "Executor.hpp"
+#include "MappedFile.hpp"
 
 namespace cbot
 {
@@ -30,11 +49,131 @@ namespace cbot
         return table[location.integer][location.character];
     }
 
-    double board_score(const cbn::ChessBoard& board, const cbn::Piece_color& color)
+    struct PawnEntry
+    // cached evaluation of one pawn structure for both colors
+    {
+        zobrist::key_type key = 0;
+        std::array<double, 2> structure{};   // passed, doubled and isolated pawn terms per color
+        std::array<std::array<std::uint8_t, cbn::CHESS_BOARD_SIZE>, 2> shelter{};    // own pawns shielding a king on file x per color
+    };
+
+    class PawnHashTable
+    // direct mapped table of pawn evaluations indexed by ChessBoard::pawn_hash()
+    {
+    public:
+        PawnHashTable()
+            :table(PAWN_HASH_SIZE)  {   }
+
+        const PawnEntry& probe(const cbn::ChessBoard& board);
+
+    private:
+        std::vector<PawnEntry> table;
+    };
+
+    int color_index(const cbn::Piece_color& color)
+    {
+        return static_cast<int>(color);
+    }
+
+    int pawn_advancement(const cbn::Piece_color& color, const cbn::ChessCoordinate& location)
+    // return number of ranks the pawn has moved from its starting rank
+    {
+        if (color == cbn::Piece_color::White)
+            return cbn::RANK_7_INDEX - location.integer;
+        return location.integer - cbn::RANK_2_INDEX;
+    }
+
+    PawnEntry evaluate_pawns(const cbn::ChessBoard& board)
+    // return pawn structure evaluation of board computed from scratch
+    {
+        PawnEntry entry;
+        entry.key = board.pawn_hash();
+
+        // pawns per file for each color
+        std::array<std::array<int, cbn::CHESS_BOARD_SIZE>, 2> file_count{};
+        cbn::coordinate_container pawns;
+
+        for (int rank_index = 0; rank_index < cbn::CHESS_BOARD_SIZE; ++rank_index)
+        {
+            for (int piece_index = 0; piece_index < cbn::CHESS_BOARD_SIZE; ++piece_index)
+            {
+                cbn::ChessCoordinate current{piece_index, rank_index};
+                const cbn::Piece& current_piece = board[current];
+
+                if (current_piece.type != cbn::Piece_type::Pawn)
+                    continue;
+
+                ++file_count[color_index(current_piece.color)][piece_index];
+                pawns.push_back(current);
+            }
+        }
+
+        for (const auto& pawn : pawns)
+        {
+            const cbn::Piece_color color = board[pawn].color;
+            const int us = color_index(color);
+            const int forward = (color == cbn::Piece_color::White) ? -1 : 1;    // white pawns move to lower rank indexes
+            double& score = entry.structure[us];
+
+            // doubled --> every pawn on a file with more than one own pawn
+            if (file_count[us][pawn.character] > 1)
+                score -= DOUBLED_PAWN_PENALTY;
+
+            // isolated --> no own pawn on the neighbouring files
+            bool left_empty = pawn.character == 0 || file_count[us][pawn.character - 1] == 0;
+            bool right_empty = pawn.character == cbn::MAX_INDEX || file_count[us][pawn.character + 1] == 0;
+            if (left_empty && right_empty)
+                score -= ISOLATED_PAWN_PENALTY;
+
+            // passed --> no enemy pawn in front of it on the same or neighbouring files
+            bool passed = true;
+            for (int file = std::max(pawn.character - 1, 0); file <= std::min(pawn.character + 1, cbn::MAX_INDEX) && passed; ++file)
+            {
+                for (int rank = pawn.integer + forward; cbn::MIN_INDEX <= rank && rank <= cbn::MAX_INDEX; rank += forward)
+                {
+                    const cbn::Piece& piece = board[cbn::ChessCoordinate{file, rank}];
+                    if (piece.type == cbn::Piece_type::Pawn && piece.color != color)
+                    {
+                        passed = false;
+                        break;
+                    }
+                }
+            }
+            if (passed)
+                score += passed_pawn_bonus[pawn_advancement(color, pawn)];
+
+            // shelter --> pawn stands close in front of its back rank, count it for the king files next to it
+            const int back_rank = (color == cbn::Piece_color::White) ? cbn::WHITE_BACK_RANK : cbn::BLACK_BACK_RANK;
+            if (abs(pawn.integer - back_rank) <= SHELTER_DEPTH)
+            {
+                for (int file = std::max(pawn.character - 1, 0); file <= std::min(pawn.character + 1, cbn::MAX_INDEX); ++file)
+                    ++entry.shelter[us][file];
+            }
+        }
+
+        return entry;
+    }
+
+    const PawnEntry& PawnHashTable::probe(const cbn::ChessBoard& board)
+    // return cached pawn evaluation, evaluate and store it on a miss
+    {
+        PawnEntry& entry = table[board.pawn_hash() & (table.size() - 1)];
+
+        if (entry.key != board.pawn_hash())
+        {
+            counters::count<counters::Counter::PawnTableMisses>();
+            entry = evaluate_pawns(board);
+        }
+
+        return entry;
+    }
+
+    double board_score(const cbn::ChessBoard& board, const cbn::Piece_color& color, const PawnEntry& pawns)
     // return the board score for color
-    // Influenced by piece and its location
+    // Influenced by piece and its location and the pawn structure
     {
         double score = 0;
+        const int back_rank = (color == cbn::Piece_color::White) ? cbn::WHITE_BACK_RANK : cbn::BLACK_BACK_RANK;
 
         // iterate over each piece of the board
         for (int rank_index = 0; rank_index < cbn::CHESS_BOARD_SIZE; ++rank_index)
@@ -48,109 +187,1429 @@ namespace cbot
                 if (current_piece.color != color)
                     continue;
 
-                score += piece_score.at(current_piece.type) * multiplier_table(current_piece.type, current);
+                score += piece_value.at(current_piece.type) * multiplier_table(current_piece.type, current);
+
+                // pawns only shelter a king that still stands on its back rank
+                if (current_piece.type == cbn::Piece_type::King && rank_index == back_rank)
+                    score += SHELTER_PAWN_BONUS * pawns.shelter[color_index(color)][piece_index];
             }
         }
-        return score;
+        return score + pawns.structure[color_index(color)];
     }
 
-    class Engine{
+    double board_score(const cbn::ChessBoard& board, const cbn::Piece_color& color, PawnHashTable& pawn_table)
+    // return the board score for color, pawn structure is looked up in pawn_table first
+    {
+        return board_score(board, color, pawn_table.probe(board));
+    }
+
+    double board_score(const cbn::ChessBoard& board, const cbn::Piece_color& color)
+    // return the board score for color without any caching
+    {
+        return board_score(board, color, evaluate_pawns(board));
+    }
+
+    enum class Bound
+    {
+        Exact, Lower, Upper
+    };
+
+    struct TranspositionEntry
+    {
+        zobrist::key_type key = 0;
+        cbn::ChessNotation move;    // best move found in the position
+        double score = 0;
+        int depth = -1;
+        Bound bound = Bound::Exact; // score is exact or only a lower / upper bound of the real score
+    };
+
+    // entries are saved and mapped back byte for byte
+    static_assert(std::is_trivially_copyable<TranspositionEntry>::value, "TranspositionEntry must be trivially copyable");
+
+    struct SnapshotHeader
+    // start of a transposition table snapshot, the entries follow it
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t entry_size;
+        zobrist::key_type key_schema;  // zobrist::SCHEMA of the build that saved the entries
+        std::uint64_t entry_count;
+        std::uint64_t checksum;        // of the entries
+    };
+
+    // return 64 bit checksum of size bytes at data
+    std::uint64_t checksum(const char* data, std::size_t size);
+
+    class TranspositionTable
+    // direct mapped table of search results indexed by ChessBoard::hash()
+    // the key covers castling rights and en passant --> positions differing in them never share an entry
+    {
     public:
-        Engine()  {   }
+        TranspositionTable()
+            :table(TRANSPOSITION_TABLE_SIZE), entries(table.data()), entry_count(table.size())    {   }
 
-        double minimax(cbn::ChessBoard board, const int depth = 2)
-        {
-            auto compare_operator = [](double x, double y){ return x > y; };
-            
-            if (depth == 0 || board.is_game_over(board.colors_turn()))
-                return cbot::board_score(board, board.colors_turn());
+        TranspositionTable(const TranspositionTable&) = delete;
+        TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+        const TranspositionEntry* probe(zobrist::key_type key) const;
+
+        void store(zobrist::key_type key, int depth, double score, Bound bound, const cbn::ChessNotation& move);
+
+        // write every entry to path, throws SnapshotWriteError
+        void save(const std::string& path) const;
+
+        // use the entries of the snapshot at path, mapped copy on write --> pages the search does not
+        // overwrite stay shared with every process using the snapshot
+        // throws BadSnapshotError and keeps the current entries if path is no intact snapshot of this build
+        void load(const std::string& path);
+
+    private:
+        std::vector<TranspositionEntry> table;      // own entries, given up when a snapshot is loaded
+        std::unique_ptr<io::MappedFile> snapshot;
+        TranspositionEntry* entries;
+        std::size_t entry_count;                    // power of 2
+    };
+
+    double score_to_table(double score, int ply)
+    // mate scores are stored as distance from the node instead of distance from the root
+    {
+        if (score > MATE_SCORE - MAX_SEARCH_DEPTH)
+            return score + ply;
+        if (score < -MATE_SCORE + MAX_SEARCH_DEPTH)
+            return score - ply;
+        return score;
+    }
+
+    double score_from_table(double score, int ply)
+    {
+        if (score > MATE_SCORE - MAX_SEARCH_DEPTH)
+            return score - ply;
+        if (score < -MATE_SCORE + MAX_SEARCH_DEPTH)
+            return score + ply;
+        return score;
+    }
+
+    bool is_capture(const cbn::ChessBoard& board, const cbn::ChessNotation& move)
+    // return true if move takes a piece, a pawn moving diagonally to an empty square takes en passant
+    {
+        if (!cbn::is_empty(board[move.to]))
+            return true;
+        return board[move.from].type == cbn::Piece_type::Pawn && move.from.character != move.to.character;
+    }
+
+    int victim_score(const cbn::ChessBoard& board, const cbn::ChessNotation& move)
+    // return score of the piece taken by capture move
+    {
+        if (cbn::is_empty(board[move.to]))
+            return piece_score.at(cbn::Piece_type::Pawn);
+        return piece_score.at(board[move.to].type);
+    }
+
+    int see(const cbn::ChessBoard& board, const cbn::ChessNotation& move)
+    // static exchange evaluation --> return material won by capture move, in piece_score units, if both colors keep taking
+    // on its square with their least valuable attacker for as long as it pays, no move is made
+    // pins and promotions are not looked at
+    {
+        using namespace chess_square;
+
+        const Square from = to_square(move.from);
+        const Square to = to_square(move.to);
+
+        std::array<int, MAX_EXCHANGE> gain;
+        int exchange = 0;
 
-            lmn::Legalmoves legal(board);
+        square_mask occupied = board.occupancy() ^ bit(from);
+        gain[0] = see_value[static_cast<int>(board[move.to].type)];
 
-            double value, best_score;
+        // en passant --> the taken pawn stands beside the target square
+        if (cbn::is_empty(board[move.to]))
+        {
+            occupied &= ~bit(make_square(move.to.character, move.from.integer));
+            gain[0] = see_value[static_cast<int>(cbn::Piece_type::Pawn)];
+        }
 
-            // Bot is moving black so search for the best moves
-            if (board.colors_turn() == cbn::Piece_color::Black)
+        int on_square = see_value[static_cast<int>(board[move.from].type)];    // value of the piece the next capture takes
+        cbn::Piece_color side = cbn::enemy_color.at(board[move.from].color);
+        square_mask attackers = board.attackers_to(to, occupied);
+
+        while (exchange + 1 < MAX_EXCHANGE)
+        {
+            // least valuable attacker of side
+            Square taker{0};
+            int taker_value = 0;
+            for (square_mask candidates = attackers; candidates != 0; candidates &= candidates - 1)
             {
-                double best_score = std::numeric_limits<double>::lowest();  // lowest best score possible for double as staring point
+                const Square candidate{static_cast<std::uint8_t>(__builtin_ctzll(candidates))};
+                const cbn::Piece& piece = board[to_coordinate(candidate)];
+                if (piece.color == side && (taker_value == 0 || see_value[static_cast<int>(piece.type)] < taker_value))
+                {
+                    taker = candidate;
+                    taker_value = see_value[static_cast<int>(piece.type)];
+                }
             }
-            else
+            if (taker_value == 0)
+                break;
+
+            ++exchange;
+            gain[exchange] = on_square - gain[exchange - 1];
+
+            // side loses material whether it takes or not --> it stops, the result keeps its sign
+            if (std::max(-gain[exchange - 1], gain[exchange]) < 0)
             {
-                // Human is moving white so hope for the worst moves
-                double best_score = std::numeric_limits<double>::max();  // highest best score possible for double as staring point
-                auto compare_operator = [](double x, double y){ return x < y; };    
+                --exchange;
+                break;
             }
 
-            // iterate all legal moves
-            for (int rank_index = 0; rank_index < cbn::CHESS_BOARD_SIZE; ++rank_index)
-            {
-                for (int piece_index = 0; piece_index < cbn::CHESS_BOARD_SIZE; ++piece_index)
-                {
-                    cbn::ChessCoordinate current{piece_index, rank_index};
-                    const cbn::Piece& current_piece = board[current];
+            // the taker leaves its square, sliders behind it join in
+            occupied ^= bit(taker);
+            attackers = board.attackers_to(to, occupied);
+            on_square = taker_value;
+            side = cbn::enemy_color.at(side);
+        }
 
-                    // if color != moving_color --> continue iterating
-                    if (current_piece.color != board.colors_turn())
-                        continue;
+        // a color stops taking where going on would lose more
+        while (exchange > 0)
+        {
+            gain[exchange - 1] = -std::max(-gain[exchange - 1], gain[exchange]);
+            --exchange;
+        }
+        return gain[0];
+    }
 
-                    const auto& move_list = legal.get_legal_moves(current);
-                    for (const auto& destination : move_list)
-                    {
-                        cbn::ChessNotation notation{current, destination};
-                        cbn::TemporalMove _{board, notation};
+    template <typename Iterator, typename Compare>
+    void insertion_sort(Iterator first, Iterator last, Compare comp)
+    // stable sort without the temporary buffer of std::stable_sort, move lists are short
+    {
+        for (Iterator i = first; i != last; ++i)
+        {
+            auto value = *i;
+            Iterator j = i;
+            for (; j != first && comp(value, *(j - 1)); --j)
+                *j = *(j - 1);
+            *j = value;
+        }
+    }
 
-                        value = minimax(board, depth - 1);
+    using killer_moves = std::array<cbn::ChessNotation, KILLER_SLOTS>;
 
-                        if (compare_operator(value, best_score))
-                            best_score = value;
-                    }
-                }
-            }
+    class MovePicker
+    // hand out the legal moves of a node one at a time
+    // a stage is generated only once the stages before it are used up,
+    // so a node cutting off after its first moves skips most of the generation
+    {
+    public:
+        MovePicker(cbn::ChessBoard& b, const cbn::ChessNotation& hash, const killer_moves& k)
+            :board(b), legal(b), hash_move(hash), killers(k)   {   }
 
-            return best_score;
+        // captures only, winning and even ones before losing ones, for the quiescence search
+        explicit MovePicker(cbn::ChessBoard& b)
+            :board(b), legal(b), hash_move(), killers(), captures_only(true)   {   }
+
+        // return false once every move was handed out
+        bool next(cbn::ChessNotation& move);
+
+        // return true if the move handed out last is a capture losing material
+        bool losing() const
+        {
+            return stage == Stage::BadCaptures;
         }
 
-        cbn::ChessNotation best_notation(cbn::ChessBoard board, const int depth = 2)
+    private:
+        enum class Stage
         {
-            // Pre-Condition: depth exists and game is not over
-            if (depth == 0 || board.is_game_over(board.colors_turn()))
-                return cbn::ChessNotation{};
+            HashMove, GenerateCaptures, GoodCaptures, Killers, GenerateQuiets, Quiets, BadCaptures, Done
+        };
 
-            lmn::Legalmoves legal(board);
+        bool is_legal(const cbn::ChessNotation& move);
+        bool was_picked(const cbn::ChessNotation& move) const;
+        void generate(const lmn::Generation& kind, cbn::notation_container& moves);
 
-            cbn::ChessNotation best_notation;
-            double best_score = std::numeric_limits<double>::lowest();  // lowest best score possible for double as staring point
+        cbn::ChessBoard& board;
+        lmn::Legalmoves legal;
+        const cbn::ChessNotation hash_move;
+        const killer_moves killers;
+        const bool captures_only = false;
 
-            // iterate all legal moves
-            for (int rank_index = 0; rank_index < cbn::CHESS_BOARD_SIZE; ++rank_index)
-            {
-                for (int piece_index = 0; piece_index < cbn::CHESS_BOARD_SIZE; ++piece_index)
-                {
-                    cbn::ChessCoordinate current{piece_index, rank_index};
-                    const cbn::Piece& current_piece = board[current];
+        Stage stage = Stage::HashMove;
+        std::size_t index = 0;  // next move of the current stage
+        cbn::notation_container good_captures, bad_captures, quiets;
 
-                    // if color != moving_color --> continue iterating
-                    if (current_piece.color != board.colors_turn())
-                        continue;
+        // moves handed out before their stage was generated, skipped when it is
+        std::array<cbn::ChessNotation, KILLER_SLOTS + 1> picked;
+        int picked_count = 0;
+    };
 
-                    const auto& move_list = legal.get_legal_moves(current);
-                    for (const auto& destination : move_list)
-                    {
-                        cbn::ChessNotation notation{current, destination};
-                        cbn::TemporalMove _{board, notation};
+    struct SearchOptions
+    // switches for the selective parts of the search, used to compare node counts
+    {
+        bool null_move = true;
+        bool late_move_reductions = true;
+        bool see_pruning = true;    // quiescence skips captures losing material, late moves reduce them like quiet moves
+    };
 
-                        double value = minimax(board, depth - 1);
+    class CancellationToken{
+    // shared flag, every copy cancels the same searches
+    public:
+        CancellationToken()
+            :flag(std::make_shared<std::atomic<bool>>(false)) {   }
 
-                        if (value > best_score)
-                        {
-                            best_notation = notation;
-                            best_score = value;
-                        }
-                    }
-                }
-            }
+        void cancel() const
+        {
+            flag->store(true, std::memory_order_relaxed);
+        }
+
+        bool cancelled() const
+        {
+            return flag->load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::shared_ptr<std::atomic<bool>> flag;
+    };
+
+    struct SearchLimits
+    // the search stops at the first limit it reaches, the first iteration always completes
+    // deadline and cancel abort the running iteration, no new iteration starts after soft_deadline
+    {
+        int depth = MAX_SEARCH_DEPTH - 1;
+        std::size_t nodes = std::numeric_limits<std::size_t>::max();
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+        std::chrono::steady_clock::time_point soft_deadline = std::chrono::steady_clock::time_point::max();
+        int multi_pv = 1;   // root moves ranked with exact scores, each with its own pv
+        CancellationToken cancel;
+    };
+
+    struct TimeControl
+    // clock of the moving color in milliseconds, a move_time above 0 overrides the clock
+    {
+        int remaining = 0;
+        int increment = 0;
+        int moves_to_go = 0;    // moves until the next time control, 0 if the clock has to last the game
+        int move_time = 0;
+    };
+
+    // return limits that spend a fitting part of clock on a move started at start
+    SearchLimits time_limits(const TimeControl& clock, std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now());
+
+    struct RootLine
+    // one of the best root moves of a multi pv search
+    {
+        cbn::ChessNotation move;    // first move of pv
+        double score = 0;
+        cbn::notation_container pv;
+    };
+
+    struct SearchResult
+    {
+        cbn::ChessNotation best;    // first move of pv
+        double score = 0;           // score of the moving color after pv is played
+        int depth = 0;              // depth of the last completed iteration
+        cbn::notation_container pv; // principal variation, expected moves of both colors
+        std::vector<RootLine> lines;    // best multi_pv root moves best first, lines[0] repeats best, score and pv
+    };
+
+    // called on the searching thread after every completed iteration
+    using ProgressCallback = std::function<void(const SearchResult&)>;
+
+    struct SearchHandle
+    // result becomes ready when the search reaches a limit or is cancelled, then it holds the last completed iteration
+    {
+        std::future<SearchResult> result;
+        CancellationToken cancel;
+    };
 
-            return best_notation;
+    // return executor shared by the asynchronous searches of all engines, a thread per core
+    executor::Executor& default_executor();
+
+    class Engine{
+    public:
+        Engine()  {   }
+
+        explicit Engine(const SearchOptions& o)
+            :options(o) {   }
+
+        Engine(const SearchOptions& o, std::shared_ptr<const nnue::Network> network)
+            :options(o), evaluator(std::move(network), MAX_SEARCH_DEPTH) {   }
+
+        ~Engine()
+        {
+            stop_ponder();
         }
+
+        double minimax(cbn::ChessBoard& board, int depth, double alpha, double beta, int ply = 0, bool null_allowed = true);
+
+        SearchResult search(cbn::ChessBoard board, const int depth = 2);
+
+        SearchResult search(cbn::ChessBoard board, const int depth, const std::chrono::steady_clock::time_point& deadline);
+
+        SearchResult search(cbn::ChessBoard board, const SearchLimits& search_limits);
+
+        cbn::ChessNotation best_notation(cbn::ChessBoard board, const int depth = 2);
+
+        // search board on pool without blocking the caller, cancel of the handle stops it within DEADLINE_CHECK_NODES nodes
+        // Pre-Condition: the engine outlives the search and runs no other search until the result is ready
+        SearchHandle search_async(cbn::ChessBoard board, SearchLimits search_limits, ProgressCallback on_progress = nullptr,
+                                  executor::Executor& pool = default_executor());
+
+        void start_ponder(cbn::ChessBoard board, const cbn::ChessNotation& expected_reply);
+
+        void stop_ponder();
+
+        std::size_t nodes() const;
+
+        // write the transposition table to path, throws SnapshotWriteError
+        void save_table(const std::string& path);
+
+        // warm start from a snapshot written by save_table, throws BadSnapshotError
+        void load_table(const std::string& path);
+
+        // record every node of the following searches into path until stop_trace
+        // throws TraceWriteError, TraceDisabledError in builds without CHESS_TRACE
+        void start_trace(const std::string& path);
+
+        // write the rest of the trace and close its file
+        void stop_trace();
+
+    private:
+        SearchResult iterate(cbn::ChessBoard& board, const int depth);
+
+        SearchResult ponder_hit(const SearchLimits& search_limits);
+
+        double search_root(cbn::ChessBoard& board, int depth, double alpha, double beta, cbn::notation_container& root_moves, int first = 0);
+
+        // return score of board after the captures worth playing, seen from the moving color
+        double quiescence(cbn::ChessBoard& board, double alpha, double beta, int ply);
+
+        // body of quiescence, fills traced only in builds with CHESS_TRACE
+        double quiescence_node(cbn::ChessBoard& board, double alpha, double beta, int ply, trace::NodeResult& traced);
+
+        // body of minimax, fills traced only in builds with CHESS_TRACE
+        double search_node(cbn::ChessBoard& board, int depth, double alpha, double beta, int ply, bool null_allowed, trace::NodeResult& traced);
+
+        // return the board score seen from the moving color, board is the position reached at ply
+        double evaluate(const cbn::ChessBoard& board, int ply);
+
+        cbn::notation_container ordered_moves(cbn::ChessBoard& board);
+
+        void update_pv(int ply, const cbn::ChessNotation& move);
+
+        void store_killer(int ply, const cbn::ChessNotation& move);
+
+        void seed_pv(cbn::ChessBoard& board);
+
+        SearchOptions options;
+        PawnHashTable pawn_table;
+        nnue::Evaluator evaluator{nullptr, MAX_SEARCH_DEPTH};  // used instead of board_score if it has a network
+        TranspositionTable transposition_table;
+        std::size_t node_count = 0;    // nodes visited by the last best_notation call
+        std::atomic<bool> stop_search{false};  // set from another thread to abort the running search
+
+        SearchLimits limits;           // limits of the running search
+        ProgressCallback progress_callback;    // of the running asynchronous search
+        std::chrono::steady_clock::time_point search_start;    // soft_deadline is stretched relative to it
+        bool limits_active = false;    // false while the first iteration runs
+
+        // triangular pv table, row ply holds the best line found from ply on
+        std::array<std::array<cbn::ChessNotation, MAX_SEARCH_DEPTH>, MAX_SEARCH_DEPTH> pv_table;
+        std::array<int, MAX_SEARCH_DEPTH> pv_length{};
+
+        std::array<killer_moves, MAX_SEARCH_DEPTH> killers;
+
+        cbn::notation_container pv_line;   // pv of the last completed iteration, searched first
+        bool follow_pv = false;            // current node lies on pv_line
+        std::size_t pv_history_size = 0;   // game history size when pv_line was found
+
+        // pondering --> searching the position after the expected enemy reply while the enemy thinks
+        std::thread ponder_thread;
+        bool pondering = false;
+        zobrist::key_type ponder_key = 0;  // ChessBoard::hash() of the position the ponder search is running on, rights included
+
+        // last completed iteration of the running search, shared with the pondering caller
+        std::mutex progress_mutex;
+        std::condition_variable progress_changed;
+        SearchResult progress;
+        bool search_running = false;
+
+        std::unique_ptr<trace::Session> tracer;    // records the search while a trace runs
     };
 }
+
+/**************************************************************************************Function definition*******************************************************************/
+
+cbot::SearchLimits cbot::time_limits(const TimeControl& clock, std::chrono::steady_clock::time_point start)
+// soft limit --> an even share of the clock plus most of the increment
+// hard limit --> a few soft limits, never more than MAX_CLOCK_SHARE of the clock
+{
+    double soft_ms, hard_ms;
+
+    if (clock.move_time > 0)
+        soft_ms = hard_ms = clock.move_time - MOVE_OVERHEAD_MS;
+    else
+    {
+        const int moves_to_go = (clock.moves_to_go > 0) ? clock.moves_to_go : DEFAULT_MOVES_TO_GO;
+        const double available = clock.remaining - MOVE_OVERHEAD_MS;
+
+        soft_ms = available / moves_to_go + INCREMENT_SHARE * clock.increment;
+        hard_ms = std::min(HARD_LIMIT_FACTOR * soft_ms, MAX_CLOCK_SHARE * available + clock.increment);
+        soft_ms = std::min(soft_ms, hard_ms);
+    }
+
+    // even a nearly empty clock gets the first iteration
+    soft_ms = std::max(soft_ms, 1.0);
+    hard_ms = std::max(hard_ms, 1.0);
+
+    SearchLimits limits;
+    limits.soft_deadline = start + std::chrono::microseconds(static_cast<long long>(soft_ms * 1000));
+    limits.deadline = start + std::chrono::microseconds(static_cast<long long>(hard_ms * 1000));
+    return limits;
+}
+
+std::uint64_t cbot::checksum(const char* data, std::size_t size)
+// fnv-1a over 8 byte words, the tail is padded with zeros
+{
+    std::uint64_t sum = 0xCBF29CE484222325ULL;
+    for (std::size_t i = 0; i < size; i += sizeof(std::uint64_t))
+    {
+        std::uint64_t word = 0;
+        std::memcpy(&word, data + i, std::min(sizeof(word), size - i));
+        sum = (sum ^ word) * 0x100000001B3ULL;
+        sum ^= sum >> 32;   // lets the high bits of a word reach the low bits of the sum
+    }
+    return sum;
+}
+
+const cbot::TranspositionEntry* cbot::TranspositionTable::probe(zobrist::key_type key) const
+// return entry stored for key or nullptr
+{
+    const TranspositionEntry& entry = entries[key & (entry_count - 1)];
+
+    if (entry.key != key || entry.depth < 0)
+        return nullptr;
+    return &entry;
+}
+
+void cbot::TranspositionTable::store(zobrist::key_type key, int depth, double score, Bound bound, const cbn::ChessNotation& move)
+// replace the entry unless it holds a deeper result of the same position
+{
+    TranspositionEntry& entry = entries[key & (entry_count - 1)];
+
+    if (entry.key == key && entry.depth > depth)
+        return;
+
+    entry = TranspositionEntry{key, move, score, depth, bound};
+}
+
+void cbot::TranspositionTable::save(const std::string& path) const
+{
+    const char* data = reinterpret_cast<const char*>(entries);
+    const std::size_t size = entry_count * sizeof(TranspositionEntry);
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.entry_size = sizeof(TranspositionEntry);
+    header.key_schema = zobrist::SCHEMA;
+    header.entry_count = entry_count;
+    header.checksum = checksum(data, size);
+
+    // written next to path and renamed --> processes mapping the old snapshot keep a complete file
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(data, size);
+        if (!file)
+            throw SnapshotWriteError;
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+        throw SnapshotWriteError;
+}
+
+void cbot::TranspositionTable::load(const std::string& path)
+{
+    std::unique_ptr<io::MappedFile> file;
+    try {
+        file = std::make_unique<io::MappedFile>(path, io::Access::CopyOnWrite);
+    }
+    catch (Exception&)
+    {
+        throw BadSnapshotError;
+    }
+
+    if (file->size() < sizeof(SnapshotHeader))
+        throw BadSnapshotError;
+
+    SnapshotHeader header;
+    std::memcpy(&header, file->data().data(), sizeof(header));
+
+    const std::uint64_t count = header.entry_count;
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 || header.version != SNAPSHOT_VERSION
+        || header.entry_size != sizeof(TranspositionEntry) || header.key_schema != zobrist::SCHEMA
+        || count == 0 || (count & (count - 1)) != 0
+        || file->size() != sizeof(SnapshotHeader) + count * sizeof(TranspositionEntry))
+        throw BadSnapshotError;
+
+    // the mapping is page aligned and the header keeps the entries aligned
+    char* data = file->writable_data() + sizeof(SnapshotHeader);
+    if (checksum(data, count * sizeof(TranspositionEntry)) != header.checksum)
+        throw BadSnapshotError;
+
+    snapshot = std::move(file);
+    entries = reinterpret_cast<TranspositionEntry*>(data);
+    entry_count = count;
+
+    table.clear();
+    table.shrink_to_fit();
+}
+
+void cbot::Engine::save_table(const std::string& path)
+// a ponder search would change the table while it is written
+{
+    stop_ponder();
+    transposition_table.save(path);
+}
+
+void cbot::Engine::load_table(const std::string& path)
+{
+    stop_ponder();
+    transposition_table.load(path);
+}
+
+void cbot::Engine::start_trace(const std::string& path)
+// a ponder search would record into the session that is replaced
+{
+    if constexpr (!trace::ENABLED)
+        throw trace::TraceDisabledError;
+
+    stop_ponder();
+    tracer.reset();
+    tracer = std::make_unique<trace::Session>(path);
+}
+
+void cbot::Engine::stop_trace()
+{
+    stop_ponder();
+    tracer.reset();
+}
+
+std::size_t cbot::Engine::nodes() const
+{
+    return node_count;
+}
+
+bool cbot::MovePicker::next(cbn::ChessNotation& move)
+{
+    switch (stage)
+    {
+        case Stage::HashMove:
+            stage = Stage::GenerateCaptures;
+            if (is_legal(hash_move))
+            {
+                picked[picked_count++] = hash_move;
+                move = hash_move;
+                return true;
+            }
+            [[fallthrough]];
+
+        case Stage::GenerateCaptures:
+        {
+            generate(lmn::Generation::Captures, good_captures);
+
+            // most valuable victim / least valuable attacker
+            auto capture_order = [this](const cbn::ChessNotation& x){
+                return victim_score(board, x) * cbn::CHESS_BOARD_SIZE - piece_score.at(board[x.from].type);
+            };
+            insertion_sort(good_captures.begin(), good_captures.end(), [&](const cbn::ChessNotation& x, const cbn::ChessNotation& y){
+                return capture_order(x) > capture_order(y);
+            });
+
+            // captures losing material once the exchange on their square is played out --> try them last
+            // a capture of a piece worth at least the taker can not lose, the exchange needs no look
+            auto is_bad = [this](const cbn::ChessNotation& x){
+                return victim_score(board, x) < piece_score.at(board[x.from].type) && see(board, x) < 0;
+            };
+            std::size_t good_count = 0;
+            for (std::size_t i = 0; i < good_captures.size(); ++i)
+            {
+                if (is_bad(good_captures[i]))
+                    bad_captures.push_back(good_captures[i]);
+                else
+                    good_captures[good_count++] = good_captures[i];
+            }
+            good_captures.resize(good_count);
+
+            stage = Stage::GoodCaptures;
+            index = 0;
+        }
+            [[fallthrough]];
+
+        case Stage::GoodCaptures:
+            while (index < good_captures.size())
+            {
+                move = good_captures[index++];
+                if (!was_picked(move))
+                    return true;
+            }
+            stage = captures_only ? Stage::BadCaptures : Stage::Killers;
+            index = 0;
+            if (captures_only)
+                return next(move);
+            [[fallthrough]];
+
+        case Stage::Killers:
+            while (index < killers.size())
+            {
+                move = killers[index++];
+                if (was_picked(move) || !is_legal(move) || is_capture(board, move))
+                    continue;
+
+                picked[picked_count++] = move;
+                return true;
+            }
+            stage = Stage::GenerateQuiets;
+            [[fallthrough]];
+
+        case Stage::GenerateQuiets:
+            generate(lmn::Generation::Quiets, quiets);
+            stage = Stage::Quiets;
+            index = 0;
+            [[fallthrough]];
+
+        case Stage::Quiets:
+            while (index < quiets.size())
+            {
+                move = quiets[index++];
+                if (!was_picked(move))
+                    return true;
+            }
+            stage = Stage::BadCaptures;
+            index = 0;
+            [[fallthrough]];
+
+        case Stage::BadCaptures:
+            while (index < bad_captures.size())
+            {
+                move = bad_captures[index++];
+                if (!was_picked(move))
+                    return true;
+            }
+            stage = Stage::Done;
+            [[fallthrough]];
+
+        case Stage::Done:
+            break;
+    }
+    return false;
+}
+
+bool cbot::MovePicker::is_legal(const cbn::ChessNotation& move)
+// return true if move is a legal move of the moving color, only generates the moves of the moving piece
+{
+    if (!move.from.is_valid() || !move.to.is_valid())
+        return false;
+    if (board[move.from].color != board.colors_turn())
+        return false;
+    return cbn::move_is_legal(legal.get_legal_moves(move.from), move);
+}
+
+bool cbot::MovePicker::was_picked(const cbn::ChessNotation& move) const
+{
+    return std::find(picked.begin(), picked.begin() + picked_count, move) != picked.begin() + picked_count;
+}
+
+void cbot::MovePicker::generate(const lmn::Generation& kind, cbn::notation_container& moves)
+// append all legal moves of kind of the moving color to moves
+{
+    for (int rank_index = 0; rank_index < cbn::CHESS_BOARD_SIZE; ++rank_index)
+    {
+        for (int piece_index = 0; piece_index < cbn::CHESS_BOARD_SIZE; ++piece_index)
+        {
+            cbn::ChessCoordinate current{piece_index, rank_index};
+
+            if (board[current].color != board.colors_turn())
+                continue;
+
+            for (const auto& destination : legal.get_legal_moves(current, kind))
+                moves.push_back(cbn::ChessNotation{current, destination, cbn::UNCHECKED});
+        }
+    }
+}
+
+double cbot::Engine::evaluate(const cbn::ChessBoard& board, int ply)
+{
+    counters::count<counters::Counter::Evaluations>();
+
+    if (evaluator.active())
+        return evaluator.evaluate(board, ply);
+
+    const cbn::Piece_color us = board.colors_turn();
+    const cbn::Piece_color them = cbn::enemy_color.at(us);
+    return board_score(board, us, pawn_table) - board_score(board, them, pawn_table);
+}
+
+cbn::notation_container cbot::Engine::ordered_moves(cbn::ChessBoard& board)
+// return all legal moves of the moving color
+// captures come first ordered by most valuable victim / least valuable attacker, quiet moves follow
+{
+    lmn::Legalmoves legal(board);
+    cbn::notation_container captures, quiets;
+
+    for (int rank_index = 0; rank_index < cbn::CHESS_BOARD_SIZE; ++rank_index)
+    {
+        for (int piece_index = 0; piece_index < cbn::CHESS_BOARD_SIZE; ++piece_index)
+        {
+            cbn::ChessCoordinate current{piece_index, rank_index};
+
+            // if color != moving_color --> continue iterating
+            if (board[current].color != board.colors_turn())
+                continue;
+
+            for (const auto& destination : legal.get_legal_moves(current))
+            {
+                cbn::ChessNotation notation{current, destination, cbn::UNCHECKED};
+
+                if (is_capture(board, notation))
+                    captures.push_back(notation);
+                else
+                    quiets.push_back(notation);
+            }
+        }
+    }
+
+    auto capture_order = [&board](const cbn::ChessNotation& x){
+        return victim_score(board, x) * cbn::CHESS_BOARD_SIZE - piece_score.at(board[x.from].type);
+    };
+    std::stable_sort(captures.begin(), captures.end(), [&](const cbn::ChessNotation& x, const cbn::ChessNotation& y){
+        return capture_order(x) > capture_order(y);
+    });
+
+    captures.insert(captures.end(), quiets.begin(), quiets.end());
+    return captures;
+}
+
+double cbot::Engine::minimax(cbn::ChessBoard& board, int depth, double alpha, double beta, int ply, bool null_allowed)
+// negamax alpha-beta search, return score of board seen from the moving color
+{
+    trace::NodeResult traced;
+    const double value = search_node(board, depth, alpha, beta, ply, null_allowed, traced);
+
+    if constexpr (trace::ENABLED)
+    {
+        if (tracer)
+            tracer->node(node_count, ply, depth, alpha, beta, value, traced);
+    }
+    return value;
+}
+
+double cbot::Engine::search_node(cbn::ChessBoard& board, int depth, double alpha, double beta, int ply, bool null_allowed, trace::NodeResult& traced)
+{
+    ++node_count;
+    counters::count<counters::Counter::SearchNodes>();
+
+    // everything the node allocates is given back when it returns
+    arena::Scope node_scope;
+
+    const cbn::Piece_color us = board.colors_turn();
+    const bool pv_node = beta - alpha > WINDOW_EPSILON;
+
+    pv_length[ply] = ply;
+
+    if (limits_active && (node_count >= limits.nodes
+        || (node_count % DEADLINE_CHECK_NODES == 0 && (limits.cancel.cancelled() || std::chrono::steady_clock::now() >= limits.deadline))))
+        stop_search = true;
+
+    if (stop_search.load(std::memory_order_relaxed))
+        return DRAW_SCORE;
+
+    // a position repeated once inside the search can be repeated again --> the cycle is a draw
+    if (board.is_repetition(1) || board.is_draw())
+        return DRAW_SCORE;
+
+    // transposition table cutoff, pv nodes are searched anyway to keep the pv complete
+    const TranspositionEntry* entry = (depth > 0) ? transposition_table.probe(board.hash()) : nullptr;
+    if (entry != nullptr)
+        counters::count<counters::Counter::TableHits>();
+    if (entry != nullptr && !pv_node && entry->depth >= depth)
+    {
+        const double table_score = score_from_table(entry->score, ply);
+
+        if (entry->bound == Bound::Exact
+            || (entry->bound == Bound::Lower && table_score >= beta)
+            || (entry->bound == Bound::Upper && table_score <= alpha))
+        {
+            counters::count<counters::Counter::TableCutoffs>();
+            return table_score;
+        }
+    }
+    const cbn::ChessNotation hash_move = (entry != nullptr) ? entry->move : cbn::ChessNotation{};
+
+    if (!board.has_any_legal_move(us))
+        return board.is_checked(us) ? -MATE_SCORE + ply : DRAW_SCORE;
+
+    if (depth <= 0 || ply >= MAX_SEARCH_DEPTH - 1)
+        return quiescence(board, alpha, beta, ply);
+
+    const bool in_check = board.is_checked(us);
+
+    // null move pruning
+    // if passing the turn still fails high the real moves will do too
+    // not done with only pawns left as zugzwang is common there
+    if (options.null_move && null_allowed && !pv_node && !in_check && depth >= NULL_MOVE_MIN_DEPTH
+        && std::abs(beta) < MATE_SCORE - MAX_SEARCH_DEPTH && board.has_non_pawn_material(us) && evaluate(board, ply) >= beta)
+    {
+        double value;
+        {
+            evaluator.push_null(ply);
+            cbn::NullMove _{board};
+            value = -minimax(board, depth - 1 - NULL_MOVE_REDUCTION, -beta, -beta + WINDOW_EPSILON, ply + 1, false);
+        }
+        if (value >= beta)
+            return beta;
+    }
+
+    const double original_alpha = alpha;
+    double best_score = -INFINITE_SCORE;
+    cbn::ChessNotation best_move;
+
+    // the move of the previous pv goes first while still following it, otherwise the best move of an earlier visit
+    const bool on_pv_line = follow_pv && ply < static_cast<int>(pv_line.size());
+    follow_pv = false;
+
+    MovePicker picker{board, on_pv_line ? pv_line[ply] : hash_move, killers[ply]};
+    cbn::ChessNotation notation;
+
+    for (int index = 0; picker.next(notation); ++index)
+    {
+        const bool quiet = !is_capture(board, notation);
+
+        // late move reductions
+        // quiet moves and captures losing material ordered late rarely raise alpha, search them shallower first
+        int reduction = 0;
+        if (options.late_move_reductions && !in_check && depth >= LMR_MIN_DEPTH && index >= LMR_MIN_MOVE_INDEX
+            && (quiet || (options.see_pruning && picker.losing())))
+            reduction = std::min(lmr_reductions[std::min(depth, MAX_SEARCH_DEPTH - 1)][std::min(index, MAX_MOVES - 1)], depth - 2);
+
+        evaluator.push_move(board, notation, ply);
+        cbn::TemporalMove _{board, notation};
+
+        double value;
+
+        if (index == 0)
+        {
+            follow_pv = on_pv_line && notation == pv_line[ply];
+            value = -minimax(board, depth - 1, -beta, -alpha, ply + 1);
+            follow_pv = false;
+        }
+        else
+        {
+            // principal variation search
+            // the first move is expected to be best, prove the others worse with a zero window
+            value = -minimax(board, depth - 1 - reduction, -alpha - WINDOW_EPSILON, -alpha, ply + 1);
+
+            // reduced move beats alpha --> verify it at full depth
+            if (reduction > 0 && value > alpha)
+                value = -minimax(board, depth - 1, -alpha - WINDOW_EPSILON, -alpha, ply + 1);
+
+            // move might be better than the first one --> search it with the full window
+            if (value > alpha && value < beta)
+                value = -minimax(board, depth - 1, -beta, -alpha, ply + 1);
+        }
+
+        // aborted --> value is meaningless
+        if (stop_search.load(std::memory_order_relaxed))
+            return DRAW_SCORE;
+
+        if (value > best_score)
+        {
+            best_score = value;
+            best_move = notation;
+        }
+        if (value > alpha)
+        {
+            alpha = value;
+            update_pv(ply, notation);
+        }
+        if (alpha >= beta)
+        {
+            if (quiet)
+                store_killer(ply, notation);
+            if constexpr (trace::ENABLED)
+                traced.cutoff = index;
+            break;
+        }
+    }
+
+    if constexpr (trace::ENABLED)
+        traced.move = best_move;
+
+    Bound bound = Bound::Exact;
+    if (best_score <= original_alpha)
+        bound = Bound::Upper;
+    else if (best_score >= beta)
+        bound = Bound::Lower;
+    transposition_table.store(board.hash(), depth, score_to_table(best_score, ply), bound, best_move);
+
+    return best_score;
+}
+
+double cbot::Engine::quiescence(cbn::ChessBoard& board, double alpha, double beta, int ply)
+{
+    trace::NodeResult traced;
+    const double value = quiescence_node(board, alpha, beta, ply, traced);
+
+    if constexpr (trace::ENABLED)
+    {
+        if (tracer)
+            tracer->node(node_count, ply, 0, alpha, beta, value, traced);
+    }
+    return value;
+}
+
+double cbot::Engine::quiescence_node(cbn::ChessBoard& board, double alpha, double beta, int ply, trace::NodeResult& traced)
+// only captures are searched, the moving color may stand pat on the static evaluation instead of taking
+// in check every move is searched as standing pat is no option
+{
+    ++node_count;
+    counters::count<counters::Counter::SearchNodes>();
+
+    // everything the node allocates is given back when it returns
+    arena::Scope node_scope;
+
+    if (limits_active && (node_count >= limits.nodes
+        || (node_count % DEADLINE_CHECK_NODES == 0 && (limits.cancel.cancelled() || std::chrono::steady_clock::now() >= limits.deadline))))
+        stop_search = true;
+
+    if (stop_search.load(std::memory_order_relaxed))
+        return DRAW_SCORE;
+
+    if (ply >= MAX_SEARCH_DEPTH - 1)
+        return evaluate(board, ply);
+
+    const cbn::Piece_color us = board.colors_turn();
+    const bool in_check = board.is_checked(us);
+
+    double best_score = -INFINITE_SCORE;
+    if (!in_check)
+    {
+        best_score = evaluate(board, ply);
+        if (best_score >= beta)
+            return best_score;
+        alpha = std::max(alpha, best_score);
+    }
+
+    MovePicker picker = in_check ? MovePicker{board, cbn::ChessNotation{}, killer_moves{}} : MovePicker{board};
+    cbn::ChessNotation notation;
+    int index = -1;
+
+    while (picker.next(notation))
+    {
+        // exchanges losing material would not be played instead of standing pat
+        if (!in_check && options.see_pruning && picker.losing())
+            break;
+
+        ++index;
+        double value;
+        {
+            evaluator.push_move(board, notation, ply);
+            cbn::TemporalMove _{board, notation};
+            value = -quiescence(board, -beta, -alpha, ply + 1);
+        }
+
+        if (stop_search.load(std::memory_order_relaxed))
+            return DRAW_SCORE;
+
+        if (value > best_score)
+        {
+            best_score = value;
+            if constexpr (trace::ENABLED)
+                traced.move = notation;
+        }
+        if (value > alpha)
+            alpha = value;
+        if (alpha >= beta)
+        {
+            if constexpr (trace::ENABLED)
+                traced.cutoff = index;
+            break;
+        }
+    }
+
+    // no move out of check --> mated
+    if (in_check && index < 0)
+        return -MATE_SCORE + ply;
+
+    return best_score;
+}
+
+double cbot::Engine::search_root(cbn::ChessBoard& board, int depth, double alpha, double beta, cbn::notation_container& root_moves, int first)
+// search the root moves from index first on inside the (alpha, beta) window, the ones before first are left out
+// the best move found is moved to index first so the next iteration searches it first
+{
+    double best_score = -INFINITE_SCORE;
+    pv_length[0] = 0;
+
+    for (int index = first; index < static_cast<int>(root_moves.size()); ++index)
+    {
+        double value;
+        {
+            evaluator.push_move(board, root_moves[index], 0);
+            cbn::TemporalMove _{board, root_moves[index]};
+
+            if (index == first)
+            {
+                follow_pv = !pv_line.empty() && pv_line.front() == root_moves[index];
+                value = -minimax(board, depth - 1, -beta, -alpha, 1);
+                follow_pv = false;
+            }
+            else
+            {
+                value = -minimax(board, depth - 1, -alpha - WINDOW_EPSILON, -alpha, 1);
+                if (value > alpha && value < beta)
+                    value = -minimax(board, depth - 1, -beta, -alpha, 1);
+            }
+        }
+
+        if (stop_search.load(std::memory_order_relaxed))
+            break;
+
+        if (value > best_score)
+            best_score = value;
+        if (value > alpha)
+        {
+            alpha = value;
+            update_pv(0, root_moves[index]);
+            std::rotate(root_moves.begin() + first, root_moves.begin() + index, root_moves.begin() + index + 1);
+        }
+        if (alpha >= beta)
+            break;
+    }
+
+    return best_score;
+}
+
+void cbot::Engine::update_pv(int ply, const cbn::ChessNotation& move)
+// move became best at ply --> pv of ply is move followed by the pv of the next ply
+{
+    pv_table[ply][ply] = move;
+    for (int next = ply + 1; next < pv_length[ply + 1]; ++next)
+        pv_table[ply][next] = pv_table[ply + 1][next];
+    pv_length[ply] = std::max(pv_length[ply + 1], ply + 1);
+}
+
+void cbot::Engine::store_killer(int ply, const cbn::ChessNotation& move)
+// remember a quiet move that caused a cutoff, the oldest killer of ply is dropped
+{
+    auto& slots = killers[ply];
+    if (slots.front() == move)
+        return;
+
+    std::move_backward(slots.begin(), slots.end() - 1, slots.end());
+    slots.front() = move;
+}
+
+void cbot::Engine::seed_pv(cbn::ChessBoard& board)
+// keep the rest of the last pv if the game went on along it, otherwise forget it
+{
+    const auto& history = board.get_history();
+    const std::size_t played = history.size() - pv_history_size;
+
+    if (history.size() < pv_history_size || played > pv_line.size()
+        || !std::equal(pv_line.begin(), pv_line.begin() + played, history.end() - played))
+    {
+        pv_line.clear();
+        return;
+    }
+
+    pv_line.erase(pv_line.begin(), pv_line.begin() + played);
+}
+
+cbot::SearchResult cbot::Engine::search(cbn::ChessBoard board, const int depth)
+// return result of searching board to depth
+{
+    SearchLimits search_limits;
+    search_limits.depth = depth;
+    return search(board, search_limits);
+}
+
+cbot::SearchResult cbot::Engine::search(cbn::ChessBoard board, const int depth, const std::chrono::steady_clock::time_point& deadline)
+// return result of searching board to depth or of the last iteration completed before deadline
+{
+    SearchLimits search_limits;
+    search_limits.depth = depth;
+    search_limits.deadline = deadline;
+    return search(board, search_limits);
+}
+
+cbot::SearchResult cbot::Engine::search(cbn::ChessBoard board, const SearchLimits& search_limits)
+// return result of the last iteration completed within search_limits
+// a ponder search on the same position is continued, any other ponder search is stopped
+{
+    if (pondering)
+    {
+        if (board.hash() == ponder_key)
+        {
+            SearchResult result = ponder_hit(search_limits);
+            if (result.depth > 0)
+                return result;
+        }
+        else
+            stop_ponder();
+    }
+
+    stop_search = false;
+    limits = search_limits;
+    search_start = std::chrono::steady_clock::now();
+    return iterate(board, limits.depth);
+}
+
+cbot::SearchResult cbot::Engine::iterate(cbn::ChessBoard& board, const int depth)
+// iterative deepening search, every iteration uses an aspiration window around the previous score
+// multi pv --> every iteration searches limits.multi_pv lines, line k leaves out the moves of lines 0 to k-1
+// and gets its own window around its previous score, all lines share the transposition table
+// return result of the last completed iteration
+{
+    node_count = 0;
+    SearchResult result;
+    killers.fill(killer_moves{});
+    evaluator.reset();
+
+    {
+        std::lock_guard<std::mutex> lock(progress_mutex);
+        progress = result;
+    }
+
+    // Pre-Condition: depth exists and game is not over
+    if (depth == 0 || board.is_game_over(board.colors_turn()))
+        return result;
+
+    seed_pv(board);
+    pv_history_size = board.get_history().size();
+
+    auto root_moves = ordered_moves(board);
+    if (!pv_line.empty())
+    {
+        auto pv_move = std::find(root_moves.begin(), root_moves.end(), pv_line.front());
+        if (pv_move != root_moves.end())
+            std::rotate(root_moves.begin(), pv_move, pv_move + 1);
+        else
+            pv_line.clear();
+    }
+
+    const int line_count = std::max(1, std::min(limits.multi_pv, static_cast<int>(root_moves.size())));
+    std::vector<double> scores(line_count, 0);  // score of every line in the previous iteration
+    double instability = 0;    // grows with every change of the best move, halves while it stays
+
+    // warm start --> an earlier search of board left its result in the table (e.g. a loaded snapshot),
+    // it stands in for the iterations up to its depth and is returned if the first one is aborted
+    // the table only knows the best move, a multi pv search starts from scratch
+    int first_depth = 1;
+    const TranspositionEntry* root_entry = transposition_table.probe(board.hash());
+    if (line_count == 1 && root_entry != nullptr && root_entry->bound == Bound::Exact && root_entry->depth > 1)
+    {
+        auto known = std::find(root_moves.begin(), root_moves.end(), root_entry->move);
+        if (known != root_moves.end())
+        {
+            std::rotate(root_moves.begin(), known, known + 1);
+
+            first_depth = std::min(root_entry->depth, depth);
+            scores[0] = score_from_table(root_entry->score, 0);
+            result.best = root_entry->move;
+            result.score = scores[0];
+            result.depth = first_depth;
+            result.pv.assign(1, result.best);
+            result.lines.assign(1, RootLine{result.best, result.score, result.pv});
+        }
+    }
+
+    for (int current_depth = first_depth; current_depth <= depth; ++current_depth)
+    {
+        const auto iteration_start = std::chrono::steady_clock::now();
+        limits_active = current_depth > 1 || result.depth > 0;
+
+        std::vector<RootLine> lines;
+        for (int line = 0; line < line_count && !stop_search; ++line)
+        {
+            double delta = ASPIRATION_WINDOW;
+            double alpha = -INFINITE_SCORE;
+            double beta = INFINITE_SCORE;
+
+            const double previous_score = scores[line];
+
+            if (current_depth > 1)
+            {
+                alpha = previous_score - delta;
+                beta = previous_score + delta;
+            }
+
+            double score = 0;
+            while (!stop_search)
+            {
+                score = search_root(board, current_depth, alpha, beta, root_moves, line);
+
+                if (alpha < score && score < beta)
+                    break;
+
+                // failed low or high --> widen the window on the failing side and search again
+                delta *= 2;
+                if (delta > ASPIRATION_MAX_WINDOW)
+                    delta = INFINITE_SCORE;
+
+                if (score <= alpha)
+                    alpha = std::max(previous_score - delta, -INFINITE_SCORE);
+                else
+                    beta = std::min(previous_score + delta, INFINITE_SCORE);
+            }
+
+            if (stop_search)
+                break;
+
+            scores[line] = score;
+            lines.push_back(RootLine{root_moves[line], score, cbn::notation_container(pv_table[0].begin(), pv_table[0].begin() + pv_length[0])});
+        }
+
+        // iteration was aborted --> keep the result of the previous one
+        if (stop_search)
+            break;
+
+        pv_line = lines.front().pv;
+
+        instability = instability / 2 + ((current_depth > 1 && root_moves.front() != result.best) ? 1 : 0);
+
+        result.best = root_moves.front();
+        result.score = scores[0];
+        result.depth = current_depth;
+        result.pv = pv_line;
+        result.lines = std::move(lines);
+
+        transposition_table.store(board.hash(), current_depth, score_to_table(result.score, 0), Bound::Exact, result.best);
+
+        if constexpr (trace::ENABLED)
+        {
+            if (tracer)
+                tracer->iteration(iteration_start, current_depth, result.score);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            progress = result;
+        }
+        progress_changed.notify_all();
+
+        if (progress_callback)
+            progress_callback(result);
+
+        if (limits.cancel.cancelled())
+            break;
+
+        // the next iteration would hardly finish --> stop at the soft limit, later while the best move changes
+        if (limits.soft_deadline != std::chrono::steady_clock::time_point::max())
+        {
+            const auto stretched = search_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                (limits.soft_deadline - search_start) * (1 + INSTABILITY_STRETCH * instability));
+            if (std::chrono::steady_clock::now() >= std::min(stretched, limits.deadline))
+                break;
+        }
+    }
+
+    return result;
+}
+
+cbn::ChessNotation cbot::Engine::best_notation(cbn::ChessBoard board, const int depth)
+{
+    return search(board, depth).best;
+}
+
+executor::Executor& cbot::default_executor()
+{
+    static executor::Executor shared;
+    return shared;
+}
+
+cbot::SearchHandle cbot::Engine::search_async(cbn::ChessBoard board, SearchLimits search_limits, ProgressCallback on_progress, executor::Executor& pool)
+{
+    SearchHandle handle;
+    handle.cancel = search_limits.cancel;
+
+    handle.result = pool.submit([this, board = std::move(board), search_limits = std::move(search_limits), on_progress = std::move(on_progress)]{
+        progress_callback = on_progress;
+        try {
+            SearchResult result = search(board, search_limits);
+            progress_callback = nullptr;
+            return result;
+        }
+        catch (...)
+        {
+            progress_callback = nullptr;
+            throw;
+        }
+    });
+    return handle;
+}
+
+void cbot::Engine::start_ponder(cbn::ChessBoard board, const cbn::ChessNotation& expected_reply)
+// play expected_reply on board and search the resulting position on a background thread
+// until search() is called for it or the ponder search is stopped
+{
+    stop_ponder();
+
+    lmn::Legalmoves legal(board);
+    board.move(legal.get_legal_moves(expected_reply.from), expected_reply);
+
+    ponder_key = board.hash();
+    pondering = true;
+    stop_search = false;
+    limits = SearchLimits{};
+
+    {
+        std::lock_guard<std::mutex> lock(progress_mutex);
+        search_running = true;
+    }
+
+    ponder_thread = std::thread([this, board]() mutable {
+        iterate(board, PONDER_MAX_DEPTH);
+
+        {
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            search_running = false;
+        }
+        progress_changed.notify_all();
+    });
+}
+
+cbot::SearchResult cbot::Engine::ponder_hit(const SearchLimits& search_limits)
+// the expected reply was played --> let the ponder search reach the depth or soft deadline of search_limits, then take its result
+{
+    {
+        std::unique_lock<std::mutex> lock(progress_mutex);
+        auto reached = [this, &search_limits]{
+            return progress.depth >= search_limits.depth || !search_running || search_limits.cancel.cancelled();
+        };
+        const auto deadline = std::min(search_limits.soft_deadline, search_limits.deadline);
+
+        if (deadline == std::chrono::steady_clock::time_point::max())
+            progress_changed.wait(lock, reached);
+        else
+            progress_changed.wait_until(lock, deadline, reached);
+    }
+
+    stop_search = true;
+    ponder_thread.join();
+    pondering = false;
+
+    std::lock_guard<std::mutex> lock(progress_mutex);
+    return progress;
+}
+
+void cbot::Engine::stop_ponder()
+// abort the ponder search, whatever it stored in the transposition table stays there
+{
+    if (!pondering)
+        return;
+
+    stop_search = true;
+    ponder_thread.join();
+    pondering = false;
+
+    // pv belongs to a position that was not reached
+    pv_line.clear();
+}
@@ -1,84 +1,15 @@
 #pragma once
 
 #include <array>
+#include <cmath>
 #include <map>
 
 #include "chess_board.hpp"
+#include "chess_bot_tables.hpp"
+#include "Exception.hpp"
 
 namespace cbot_constants
 {
-    const std::array<std::array<double, 8>, 8> multiplier_table_pawn
-    {{
-        { 0.0, 0.1, 0.1, 0.2, 0.2, 0.1, 0.1, 0.0 },
-        { 0.1, 0.2, 0.3, 0.4, 0.4, 0.3, 0.2, 0.1 },
-        { 0.1, 0.3, 0.4, 0.5, 0.5, 0.4, 0.3, 0.1 },
-        { 0.2, 0.4, 0.5, 0.6, 0.6, 0.5, 0.4, 0.2 },
-        { 0.2, 0.4, 0.6, 0.7, 0.7, 0.6, 0.4, 0.2 },
-        { 0.2, 0.3, 0.4, 0.6, 0.6, 0.4, 0.3, 0.2 },
-        { 0.1, 0.2, 0.3, 0.4, 0.4, 0.3, 0.2, 0.1 },
-        { 0.0, 0.1, 0.1, 0.2, 0.2, 0.1, 0.1, 0.0 }
-    }};
-
-    const std::array<std::array<double, 8>, 8> multiplier_table_knight
-    {{
-        { -0.5, -0.4, -0.4, -0.4, -0.4, -0.4, -0.4, -0.5 },
-        { -0.4, 0.0, 0.2, 0.2, 0.2, 0.2, 0.0, -0.4 },
-        { -0.4, 0.2, 0.4, 0.5, 0.5, 0.4, 0.2, -0.4 },
-        { -0.4, 0.2, 0.5, 0.6, 0.6, 0.5, 0.2, -0.4 },
-        { -0.4, 0.2, 0.5, 0.6, 0.6, 0.5, 0.2, -0.4 },
-        { -0.4, 0.2, 0.4, 0.5, 0.5, 0.4, 0.2, -0.4 },
-        { -0.4, 0.0, 0.2, 0.2, 0.2, 0.2, 0.0, -0.4 },
-        { -0.5, -0.4, -0.4, -0.4, -0.4, -0.4, -0.4, -0.5 }
-    }};
-
-    const std::array<std::array<double, 8>, 8> multiplier_table_bishop
-    {{
-        { -0.5, -0.3, -0.2, -0.1, -0.1, -0.2, -0.3, -0.5 },
-        { -0.3, 0.0, 0.1, 0.3, 0.3, 0.1, 0.0, -0.3 },
-        { -0.2, 0.1, 0.2, 0.4, 0.4, 0.2, 0.1, -0.2 },
-        { -0.1, 0.3, 0.4, 0.6, 0.6, 0.4, 0.3, -0.1 },
-        { -0.1, 0.3, 0.4, 0.6, 0.6, 0.4, 0.3, -0.1 },
-        { -0.2, 0.1, 0.2, 0.4, 0.4, 0.2, 0.1, -0.2 },
-        { -0.3, 0.0, 0.1, 0.3, 0.3, 0.1, 0.0, -0.3 },
-        { -0.5, -0.3, -0.2, -0.1, -0.1, -0.2, -0.3, -0.5 }
-    }};
-
-    const std::array<std::array<double, 8>, 8> multiplier_table_rook
-    {{
-        { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
-        { 0.2, 0.4, 0.4, 0.4, 0.4, 0.4, 0.4, 0.2 },
-        { 0.2, 0.4, 0.6, 0.6, 0.6, 0.6, 0.4, 0.2 },
-        { 0.2, 0.4, 0.6, 0.8, 0.8, 0.6, 0.4, 0.2 },
-        { 0.2, 0.4, 0.6, 0.8, 0.8, 0.6, 0.4, 0.2 },
-        { 0.2, 0.4, 0.6, 0.6, 0.6, 0.6, 0.4, 0.2 },
-        { 0.2, 0.4, 0.4, 0.4, 0.4, 0.4, 0.4, 0.2 },
-        { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 }
-    }};
-
-    const std::array<std::array<double, 8>, 8> multiplier_table_queen
-    {{
-        { -0.5, -0.4, -0.4, -0.3, -0.3, -0.4, -0.4, -0.5 },
-        { -0.4, -0.2, 0.0, 0.1, 0.1, 0.0, -0.2, -0.4 },
-        { -0.4, 0.0, 0.2, 0.3, 0.3, 0.2, 0.0, -0.4 },
-        { -0.3, 0.1, 0.3, 0.5, 0.5, 0.3, 0.1, -0.3 },
-        { -0.3, 0.1, 0.3, 0.5, 0.5, 0.3, 0.1, -0.3 },
-        { -0.4, 0.0, 0.2, 0.3, 0.3, 0.2, 0.0, -0.4 },
-        { -0.4, -0.2, 0.0, 0.1, 0.1, 0.0, -0.2, -0.4 },
-        { -0.5, -0.4, -0.4, -0.3, -0.3, -0.4, -0.4, -0.5 }
-    }};
-
-    const std::array<std::array<double, 8>, 8> multiplier_table_king
-    {{
-        { -0.6, -0.6, -0.6, -0.6, -0.6, -0.6, -0.6, -0.6 },
-        { -0.6, -0.4, -0.3, -0.3, -0.3, -0.3, -0.4, -0.6 },
-        { -0.6, -0.3, -0.2, -0.2, -0.2, -0.2, -0.3, -0.6 },
-        { -0.6, -0.3, -0.2, 0.0, 0.0, -0.2, -0.3, -0.6 },
-        { -0.6, -0.3, -0.2, 0.0, 0.0, -0.2, -0.3, -0.6 },
-        { -0.6, -0.4, -0.3, -0.3, -0.3, -0.3, -0.4, -0.6 },
-        { -0.6, -0.6, -0.6, -0.6, -0.6, -0.6, -0.6, -0.6 },
-        { -0.6, -0.6, -0.6, -0.6, -0.6, -0.6, -0.6, -0.6 }
-    }};
-
     std::map<cbn::Piece_type, const std::array<std::array<double, 8>, 8>&> multiplier_map
     {
         {cbn::Piece_type::Pawn, multiplier_table_pawn},
@@ -89,6 +20,7 @@ namespace cbot_constants
         {cbn::Piece_type::Queen, multiplier_table_queen},
     };
 
+    // material for ordering captures, the evaluation uses piece_value
     const std::map<cbn::Piece_type, int> piece_score
     {
         {cbn::Piece_type::Pawn, 1},
@@ -98,4 +30,73 @@ namespace cbot_constants
         {cbn::Piece_type::Queen, 9},
         {cbn::Piece_type::King, 0},
     };
+
+    // piece_score in Piece_type order for the static exchange evaluation,
+    // the king outweighs everything so taking with it only pays if nothing can take back
+    const std::array<int, cbn::PIECE_TYPE_COUNT> see_value{ 1, 5, 3, 3, 9, 100 };
+    const int MAX_EXCHANGE = 32;    // captures one square can see, one per piece
+
+    // pawn structure terms, in units of a pawn
+    const double DOUBLED_PAWN_PENALTY = 0.2;
+    const double ISOLATED_PAWN_PENALTY = 0.15;
+    const double SHELTER_PAWN_BONUS = 0.1;    // per pawn in front of a king on its back rank
+
+    // passed pawn bonus indexed by the number of ranks the pawn has advanced from its starting rank
+    const std::array<double, 8> passed_pawn_bonus{ 0.0, 0.1, 0.15, 0.3, 0.5, 0.8, 0.0, 0.0 };
+
+    const int SHELTER_DEPTH = 2;    // ranks in front of the king that count as shelter
+
+    const std::size_t PAWN_HASH_SIZE = 1 << 14; // entries of the pawn hash table, power of 2
+
+    // search
+    const double MATE_SCORE = 10000;   // score of being mated at the root, mate in n plies scores MATE_SCORE - n
+    const double DRAW_SCORE = 0;
+    const double INFINITE_SCORE = 2 * MATE_SCORE;  // bound of the full (-INFINITE_SCORE, INFINITE_SCORE) window
+    const double WINDOW_EPSILON = 1e-6;    // width of a zero window (beta - WINDOW_EPSILON, beta)
+
+    const double ASPIRATION_WINDOW = 0.5;  // half width of the first root window around the previous score
+    const double ASPIRATION_MAX_WINDOW = 8; // windows wider than this are opened up to the full window
+
+    const int NULL_MOVE_MIN_DEPTH = 3;
+    const int NULL_MOVE_REDUCTION = 2;  // depth saved by the null move on top of the skipped ply
+
+    const int LMR_MIN_DEPTH = 3;
+    const int LMR_MIN_MOVE_INDEX = 3;   // first moves of a node are always searched to full depth
+    const int MAX_SEARCH_DEPTH = 64;
+    const int MAX_MOVES = 256;
+    const int KILLER_SLOTS = 2;    // quiet moves remembered per ply because they caused a cutoff
+
+    const std::size_t TRANSPOSITION_TABLE_SIZE = 1 << 18;  // entries of the transposition table, power of 2
+
+    const char SNAPSHOT_MAGIC[8] = {'C', 'H', 'E', 'S', 'S', 'T', 'T', '\0'};
+    const std::uint32_t SNAPSHOT_VERSION = 1;  // raised whenever the layout of a snapshot or its entries changes
+
+    const Exception BadSnapshotError{"BadSnapshotError: File Is Not A Transposition Table Snapshot Of This Build"};
+    const Exception SnapshotWriteError{"SnapshotWriteError: Transposition Table Snapshot Can Not Be Written"};
+
+    const int PONDER_MAX_DEPTH = MAX_SEARCH_DEPTH - 1;   // pondering runs until it is stopped
+
+    const std::size_t DEADLINE_CHECK_NODES = 256;   // nodes searched between two looks at the clock
+
+    // time management, see cbot::time_limits
+    const int MOVE_OVERHEAD_MS = 20;           // kept back from every move for the reply to reach the user
+    const int DEFAULT_MOVES_TO_GO = 30;        // moves the remaining clock is planned for without moves to go
+    const double INCREMENT_SHARE = 0.75;       // part of the increment spent on the current move
+    const double HARD_LIMIT_FACTOR = 4;        // the hard limit allows this many soft limits
+    const double MAX_CLOCK_SHARE = 0.5;        // no move takes more than this part of the remaining clock
+    const double INSTABILITY_STRETCH = 1;      // soft limit grows by this part per recent change of the best move
+
+    using reduction_table = std::array<std::array<int, MAX_MOVES>, MAX_SEARCH_DEPTH>;
+
+    reduction_table generate_lmr_reductions()
+    // reduction grows with the logarithm of depth and move index
+    {
+        reduction_table table{};
+        for (int depth = 1; depth < MAX_SEARCH_DEPTH; ++depth)
+            for (int index = 1; index < MAX_MOVES; ++index)
+                table[depth][index] = static_cast<int>(0.75 + std::log(depth) * std::log(index) / 2.25);
+        return table;
+    }
+
+    const reduction_table lmr_reductions = generate_lmr_reductions();
 }
\ No newline at end of file
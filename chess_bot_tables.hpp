@@ -0,0 +1,94 @@
+#pragma once
+
+// piece square tables and piece values of the evaluation
+// hand picked start values, tune writes this file from labelled positions
+
+#include <array>
+#include <map>
+
+#include "chess_board.hpp"
+
+namespace cbot_constants
+{
+    const std::array<std::array<double, 8>, 8> multiplier_table_pawn
+    {{
+        { 0.0, 0.1, 0.1, 0.2, 0.2, 0.1, 0.1, 0.0 },
+        { 0.1, 0.2, 0.3, 0.4, 0.4, 0.3, 0.2, 0.1 },
+        { 0.1, 0.3, 0.4, 0.5, 0.5, 0.4, 0.3, 0.1 },
+        { 0.2, 0.4, 0.5, 0.6, 0.6, 0.5, 0.4, 0.2 },
+        { 0.2, 0.4, 0.6, 0.7, 0.7, 0.6, 0.4, 0.2 },
+        { 0.2, 0.3, 0.4, 0.6, 0.6, 0.4, 0.3, 0.2 },
+        { 0.1, 0.2, 0.3, 0.4, 0.4, 0.3, 0.2, 0.1 },
+        { 0.0, 0.1, 0.1, 0.2, 0.2, 0.1, 0.1, 0.0 }
+    }};
+
+    const std::array<std::array<double, 8>, 8> multiplier_table_knight
+    {{
+        { -0.5, -0.4, -0.4, -0.4, -0.4, -0.4, -0.4, -0.5 },
+        { -0.4, 0.0, 0.2, 0.2, 0.2, 0.2, 0.0, -0.4 },
+        { -0.4, 0.2, 0.4, 0.5, 0.5, 0.4, 0.2, -0.4 },
+        { -0.4, 0.2, 0.5, 0.6, 0.6, 0.5, 0.2, -0.4 },
+        { -0.4, 0.2, 0.5, 0.6, 0.6, 0.5, 0.2, -0.4 },
+        { -0.4, 0.2, 0.4, 0.5, 0.5, 0.4, 0.2, -0.4 },
+        { -0.4, 0.0, 0.2, 0.2, 0.2, 0.2, 0.0, -0.4 },
+        { -0.5, -0.4, -0.4, -0.4, -0.4, -0.4, -0.4, -0.5 }
+    }};
+
+    const std::array<std::array<double, 8>, 8> multiplier_table_bishop
+    {{
+        { -0.5, -0.3, -0.2, -0.1, -0.1, -0.2, -0.3, -0.5 },
+        { -0.3, 0.0, 0.1, 0.3, 0.3, 0.1, 0.0, -0.3 },
+        { -0.2, 0.1, 0.2, 0.4, 0.4, 0.2, 0.1, -0.2 },
+        { -0.1, 0.3, 0.4, 0.6, 0.6, 0.4, 0.3, -0.1 },
+        { -0.1, 0.3, 0.4, 0.6, 0.6, 0.4, 0.3, -0.1 },
+        { -0.2, 0.1, 0.2, 0.4, 0.4, 0.2, 0.1, -0.2 },
+        { -0.3, 0.0, 0.1, 0.3, 0.3, 0.1, 0.0, -0.3 },
+        { -0.5, -0.3, -0.2, -0.1, -0.1, -0.2, -0.3, -0.5 }
+    }};
+
+    const std::array<std::array<double, 8>, 8> multiplier_table_rook
+    {{
+        { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
+        { 0.2, 0.4, 0.4, 0.4, 0.4, 0.4, 0.4, 0.2 },
+        { 0.2, 0.4, 0.6, 0.6, 0.6, 0.6, 0.4, 0.2 },
+        { 0.2, 0.4, 0.6, 0.8, 0.8, 0.6, 0.4, 0.2 },
+        { 0.2, 0.4, 0.6, 0.8, 0.8, 0.6, 0.4, 0.2 },
+        { 0.2, 0.4, 0.6, 0.6, 0.6, 0.6, 0.4, 0.2 },
+        { 0.2, 0.4, 0.4, 0.4, 0.4, 0.4, 0.4, 0.2 },
+        { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 }
+    }};
+
+    const std::array<std::array<double, 8>, 8> multiplier_table_queen
+    {{
+        { -0.5, -0.4, -0.4, -0.3, -0.3, -0.4, -0.4, -0.5 },
+        { -0.4, -0.2, 0.0, 0.1, 0.1, 0.0, -0.2, -0.4 },
+        { -0.4, 0.0, 0.2, 0.3, 0.3, 0.2, 0.0, -0.4 },
+        { -0.3, 0.1, 0.3, 0.5, 0.5, 0.3, 0.1, -0.3 },
+        { -0.3, 0.1, 0.3, 0.5, 0.5, 0.3, 0.1, -0.3 },
+        { -0.4, 0.0, 0.2, 0.3, 0.3, 0.2, 0.0, -0.4 },
+        { -0.4, -0.2, 0.0, 0.1, 0.1, 0.0, -0.2, -0.4 },
+        { -0.5, -0.4, -0.4, -0.3, -0.3, -0.4, -0.4, -0.5 }
+    }};
+
+    const std::array<std::array<double, 8>, 8> multiplier_table_king
+    {{
+        { -0.6, -0.6, -0.6, -0.6, -0.6, -0.6, -0.6, -0.6 },
+        { -0.6, -0.4, -0.3, -0.3, -0.3, -0.3, -0.4, -0.6 },
+        { -0.6, -0.3, -0.2, -0.2, -0.2, -0.2, -0.3, -0.6 },
+        { -0.6, -0.3, -0.2, 0.0, 0.0, -0.2, -0.3, -0.6 },
+        { -0.6, -0.3, -0.2, 0.0, 0.0, -0.2, -0.3, -0.6 },
+        { -0.6, -0.4, -0.3, -0.3, -0.3, -0.3, -0.4, -0.6 },
+        { -0.6, -0.6, -0.6, -0.6, -0.6, -0.6, -0.6, -0.6 },
+        { -0.6, -0.6, -0.6, -0.6, -0.6, -0.6, -0.6, -0.6 }
+    }};
+
+    const std::map<cbn::Piece_type, double> piece_value
+    {
+        {cbn::Piece_type::Pawn, 1.0},
+        {cbn::Piece_type::Knight, 3.0},
+        {cbn::Piece_type::Bishop, 3.0},
+        {cbn::Piece_type::Rook, 5.0},
+        {cbn::Piece_type::Queen, 9.0},
+        {cbn::Piece_type::King, 0.0},
+    };
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "chess_board_constants.hpp"
+
+/*
+Hot path counters
+
+Compiled in with -DCHESS_COUNTERS, otherwise ENABLED is false and every count call is an empty function.
+Each thread adds to its own block of counters, a plain add as only that thread writes them, and blocks
+are only summed when a snapshot is asked for. A thread that exits folds its block into the retired sums
+so nothing it counted is lost:
+
+    counters::count<counters::Counter::Evaluations>();
+    counters::write_snapshot(std::cout);
+*/
+
+namespace counters
+{
+#ifdef CHESS_COUNTERS
+    constexpr bool ENABLED = true;
+#else
+    constexpr bool ENABLED = false;
+#endif
+
+    enum class Counter
+    {
+        LegalMoveQueries,   // Legalmoves::get_legal_moves calls
+        GeneratedPawn,      // legal destinations found per piece type, in Piece_type order
+        GeneratedRook,
+        GeneratedKnight,
+        GeneratedBishop,
+        GeneratedQueen,
+        GeneratedKing,
+        AnyLegalMoveTests,  // Legalmoves::has_any_legal_move calls
+        CheckTests,         // ChessBoard::is_checked calls
+        TemporalMoves,
+        NullMoves,
+        SearchNodes,
+        TableHits,          // transposition table entries found by the search
+        TableCutoffs,       // nodes answered by the table alone
+        Evaluations,
+        PawnTableMisses,
+        Count
+    };
+
+    const int COUNTER_COUNT = static_cast<int>(Counter::Count);
+
+    const std::array<const char*, COUNTER_COUNT> COUNTER_NAMES{
+        "legal_move_queries", "generated_pawn", "generated_rook", "generated_knight", "generated_bishop",
+        "generated_queen", "generated_king", "any_legal_move_tests", "check_tests", "temporal_moves",
+        "null_moves", "search_nodes", "table_hits", "table_cutoffs", "evaluations", "pawn_table_misses"
+    };
+
+    static_assert(static_cast<int>(Counter::GeneratedKing) - static_cast<int>(Counter::GeneratedPawn) + 1 == chess_constants::PIECE_TYPE_COUNT,
+                  "a generation counter per piece type");
+
+    using snapshot_type = std::array<std::uint64_t, COUNTER_COUNT>;
+
+    class Block{
+    public:
+        Block();
+
+        // fold the counts into the retired sums
+        ~Block();
+
+        void add(int counter, std::uint64_t amount)
+        {
+            // only the owning thread writes --> no read-modify-write has to be atomic
+            auto& value = values[counter];
+            value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+
+        void add_to(snapshot_type& sums) const;
+
+    private:
+        std::array<std::atomic<std::uint64_t>, COUNTER_COUNT> values{};
+    };
+
+    // return block of the calling thread
+    Block& thread_block();
+
+    template <Counter C>
+    inline void count(std::uint64_t amount = 1)
+    {
+        if constexpr (ENABLED)
+            thread_block().add(static_cast<int>(C), amount);
+    }
+
+    inline void count_generated(helper_classes::Piece_type type, std::size_t moves)
+    {
+        if constexpr (ENABLED)
+            thread_block().add(static_cast<int>(Counter::GeneratedPawn) + static_cast<int>(type), moves);
+    }
+
+    // return sums over all threads, running and exited
+    snapshot_type snapshot();
+
+    // write one "name value" line per counter
+    void write_snapshot(std::ostream& os);
+
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<const Block*> blocks;
+        snapshot_type retired{};
+    };
+
+    // return registry shared by all threads
+    Registry& registry();
+}
+
+/**************************************************************************************Function definition*******************************************************************/
+
+counters::Registry& counters::registry()
+{
+    static Registry shared;
+    return shared;
+}
+
+counters::Block::Block()
+{
+    Registry& shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.blocks.push_back(this);
+}
+
+counters::Block::~Block()
+{
+    Registry& shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    add_to(shared.retired);
+    shared.blocks.erase(std::find(shared.blocks.begin(), shared.blocks.end(), this));
+}
+
+void counters::Block::add_to(snapshot_type& sums) const
+{
+    for (int counter = 0; counter < COUNTER_COUNT; ++counter)
+        sums[counter] += values[counter].load(std::memory_order_relaxed);
+}
+
+counters::Block& counters::thread_block()
+{
+    thread_local Block block;
+    return block;
+}
+
+counters::snapshot_type counters::snapshot()
+{
+    Registry& shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+
+    snapshot_type sums = shared.retired;
+    for (const Block* block : shared.blocks)
+        block->add_to(sums);
+    return sums;
+}
+
+void counters::write_snapshot(std::ostream& os)
+{
+    const snapshot_type sums = snapshot();
+    for (int counter = 0; counter < COUNTER_COUNT; ++counter)
+        os << COUNTER_NAMES[counter] << ' ' << sums[counter] << '\n';
+}
@@ -0,0 +1,435 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "chess_board.hpp"
+#include "chess_pgn.hpp"
+#include "chess_zobrist.hpp"
+#include "Exception.hpp"
+#include "MappedFile.hpp"
+
+/*
+Opening explorer
+
+Position index over a game archive: for every position (its zobrist key) the moves played from it
+and how the games ended. The Builder replays games on all cores, sorts the records in runs that fit
+into memory, writes the runs to disk and merges them into one file:
+
+    Header | Record[record_count] sorted by key and move | first key of every block of BLOCK_RECORDS records
+
+The Index maps that file, finds the block of a key with a binary search over the small fence array
+and reads the continuations from one block, two if they cross a block border
+Numbers are stored in the byte order of the machine that built the file
+*/
+
+namespace explorer
+{
+    const char MAGIC[8] = {'C', 'H', 'E', 'S', 'S', 'I', 'D', 'X'};
+    const std::uint32_t VERSION = 2;
+
+    const std::size_t BLOCK_BYTES = 4096;                       // a page, the unit a lookup touches
+    const std::size_t DEFAULT_MEMORY = std::size_t{256} << 20;  // bytes of records held before a run is written
+
+    const Exception BadIndexError{"BadIndexError: File Is Not A Position Index Of This Version"};
+    const Exception IndexWriteError{"IndexWriteError: Index Or Run File Can Not Be Written"};
+
+    struct Record
+    {
+        zobrist::key_type key;
+        std::uint32_t white_wins;
+        std::uint32_t draws;
+        std::uint32_t black_wins;
+        std::uint8_t from;      // zobrist::square_index of the move
+        std::uint8_t to;
+        std::uint16_t reserved;
+    };
+
+    const std::size_t BLOCK_RECORDS = BLOCK_BYTES / sizeof(Record);
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t record_size;
+        std::uint64_t record_count;
+        std::uint64_t block_records;
+        zobrist::key_type key_schema;  // zobrist::SCHEMA of the build that keyed the positions
+    };
+
+    struct Continuation
+    {
+        cbn::ChessNotation move;
+        std::uint32_t white_wins;
+        std::uint32_t draws;
+        std::uint32_t black_wins;
+
+        std::uint64_t games() const { return std::uint64_t{white_wins} + draws + black_wins; }
+    };
+
+    // order of records in runs and in the index
+    bool operator<(const Record& lhs, const Record& rhs);
+
+    // return true if both records count the same move of the same position
+    bool same_entry(const Record& lhs, const Record& rhs);
+
+    // sort records and combine entries of the same move
+    void sort_and_combine(std::vector<Record>& records);
+
+    // return start of the first game at or behind offset, text.size() if there is none
+    std::size_t next_game_start(std::string_view text, std::size_t offset);
+
+    cbn::ChessCoordinate square_of_index(int index);
+
+    class Builder{
+    public:
+        // memory is split evenly between the threads
+        Builder(const std::string& output_path, unsigned thread_count, std::size_t memory = DEFAULT_MEMORY, std::size_t max_plies = 0);
+
+        Builder(const Builder&) = delete;
+        Builder& operator=(const Builder&) = delete;
+
+        // index every finished game of a pgn file, may be called for several files
+        void add_file(const std::string& pgn_path);
+
+        // merge the runs into the index file and remove them, return number of records
+        std::uint64_t finish();
+
+        std::size_t games() const { return game_count; }
+        std::size_t broken_games() const { return broken_count; }
+
+    private:
+        void add_text(std::string_view text);
+
+        // write buffer as a sorted run and empty it
+        void spill(std::vector<Record>& buffer);
+
+        std::string output;
+        unsigned threads;
+        std::size_t run_capacity;       // records per thread before a run is written
+        std::size_t plies;              // positions indexed per game, 0 for all
+
+        std::mutex runs_mutex;
+        std::vector<std::string> runs;
+
+        std::atomic<std::size_t> game_count{0};
+        std::atomic<std::size_t> broken_count{0};
+    };
+
+    class Index{
+    public:
+        explicit Index(const std::string& path);
+
+        // return every move played from the position with key
+        std::vector<Continuation> continuations(zobrist::key_type key) const;
+
+        std::vector<Continuation> continuations(const cbn::ChessBoard& board) const { return continuations(board.hash()); }
+
+        std::uint64_t size() const { return record_count; }
+
+    private:
+        io::MappedFile file;
+        const Record* records = nullptr;
+        const zobrist::key_type* fences = nullptr;
+        std::uint64_t record_count = 0;
+        std::uint64_t fence_count = 0;
+    };
+}
+
+/**************************************************************************************Function definition*******************************************************************/
+
+bool explorer::operator<(const Record& lhs, const Record& rhs)
+{
+    if (lhs.key != rhs.key)
+        return lhs.key < rhs.key;
+    if (lhs.from != rhs.from)
+        return lhs.from < rhs.from;
+    return lhs.to < rhs.to;
+}
+
+bool explorer::same_entry(const Record& lhs, const Record& rhs)
+{
+    return lhs.key == rhs.key && lhs.from == rhs.from && lhs.to == rhs.to;
+}
+
+void explorer::sort_and_combine(std::vector<Record>& records)
+{
+    std::sort(records.begin(), records.end());
+
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < records.size(); ++i)
+    {
+        if (kept > 0 && same_entry(records[kept - 1], records[i]))
+        {
+            records[kept - 1].white_wins += records[i].white_wins;
+            records[kept - 1].draws += records[i].draws;
+            records[kept - 1].black_wins += records[i].black_wins;
+        }
+        else
+            records[kept++] = records[i];
+    }
+    records.resize(kept);
+}
+
+std::size_t explorer::next_game_start(std::string_view text, std::size_t offset)
+// games of a pgn file start with their Event tag on a new line
+{
+    if (offset == 0)
+        return 0;
+    const std::size_t found = text.find("\n[Event ", offset - 1);
+    return (found == std::string_view::npos) ? text.size() : found + 1;
+}
+
+cbn::ChessCoordinate explorer::square_of_index(int index)
+// inverse of zobrist::square_index
+{
+    return cbn::ChessCoordinate{index % cbn::CHESS_BOARD_SIZE, index / cbn::CHESS_BOARD_SIZE};
+}
+
+explorer::Builder::Builder(const std::string& output_path, unsigned thread_count, std::size_t memory, std::size_t max_plies)
+    :output(output_path), threads(std::max(1u, thread_count)), plies(max_plies)
+{
+    run_capacity = std::max<std::size_t>(BLOCK_RECORDS, memory / sizeof(Record) / threads);
+}
+
+void explorer::Builder::add_file(const std::string& pgn_path)
+{
+    io::MappedFile file{pgn_path};
+    add_text(file.data());
+}
+
+void explorer::Builder::add_text(std::string_view text)
+// every thread reads the games of its own slice of text
+{
+    std::vector<std::size_t> bounds{0};
+    for (unsigned i = 1; i < threads; ++i)
+        bounds.push_back(std::max(bounds.back(), next_game_start(text, text.size() / threads * i)));
+    bounds.push_back(text.size());
+
+    auto index_slice = [this](std::string_view slice){
+        std::vector<Record> buffer;
+        buffer.reserve(run_capacity);
+
+        pgn::Reader reader{slice};
+        pgn::GameRecord game;
+
+        while (reader.next(game))
+        {
+            Record outcome{};
+            if (game.result == "1-0")
+                outcome.white_wins = 1;
+            else if (game.result == "0-1")
+                outcome.black_wins = 1;
+            else if (game.result == "1/2-1/2")
+                outcome.draws = 1;
+            else
+                continue;   // unfinished games tell nothing about their moves
+
+            ++game_count;
+            if (plies > 0 && game.moves.size() > plies)
+                game.moves.resize(plies);
+
+            if (buffer.size() + game.moves.size() > run_capacity)
+                spill(buffer);
+
+            // records of a game that turns out broken are taken back
+            const std::size_t game_start = buffer.size();
+            try {
+                cbn::ChessBoard board = pgn::start_position(game);
+                pgn::replay(game, board, [&buffer, &outcome](cbn::ChessBoard& position, const cbn::ChessNotation& move){
+                    Record record = outcome;
+                    record.key = position.hash();
+                    record.from = static_cast<std::uint8_t>(zobrist::square_index(move.from));
+                    record.to = static_cast<std::uint8_t>(zobrist::square_index(move.to));
+                    buffer.push_back(record);
+                });
+            }
+            catch (Exception&)
+            {
+                buffer.resize(game_start);
+                ++broken_count;
+            }
+        }
+
+        if (!buffer.empty())
+            spill(buffer);
+    };
+
+    // a run that can not be written stops its thread, the error is thrown once all are joined
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; ++i)
+    {
+        workers.emplace_back([&index_slice, &failed](std::string_view slice){
+            try {
+                index_slice(slice);
+            }
+            catch (Exception&)
+            {
+                failed = true;
+            }
+        }, text.substr(bounds[i], bounds[i + 1] - bounds[i]));
+    }
+    for (auto& worker : workers)
+        worker.join();
+
+    if (failed)
+        throw IndexWriteError;
+}
+
+void explorer::Builder::spill(std::vector<Record>& buffer)
+{
+    sort_and_combine(buffer);
+
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock{runs_mutex};
+        path = output + ".run" + std::to_string(runs.size());
+        runs.push_back(path);
+    }
+
+    std::ofstream run{path, std::ios::binary | std::ios::trunc};
+    run.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(Record));
+    if (!run)
+        throw IndexWriteError;
+
+    buffer.clear();
+}
+
+std::uint64_t explorer::Builder::finish()
+// k-way merge of the sorted runs, equal entries of different runs are combined
+{
+    std::vector<std::unique_ptr<io::MappedFile>> files;
+    for (const auto& path : runs)
+        files.push_back(std::make_unique<io::MappedFile>(path));
+
+    using cursor = std::pair<Record, std::size_t>;  // smallest unread record of a run and the run
+    auto later = [](const cursor& lhs, const cursor& rhs){ return rhs.first < lhs.first; };
+    std::priority_queue<cursor, std::vector<cursor>, decltype(later)> heads{later};
+    std::vector<std::size_t> read(files.size(), 0);
+
+    auto advance = [&files, &read, &heads](std::size_t run){
+        const std::string_view data = files[run]->data();
+        if (read[run] + sizeof(Record) > data.size())
+            return;
+        Record record;
+        std::memcpy(&record, data.data() + read[run], sizeof(Record));
+        read[run] += sizeof(Record);
+        heads.emplace(record, run);
+    };
+    for (std::size_t run = 0; run < files.size(); ++run)
+        advance(run);
+
+    std::ofstream index{output, std::ios::binary | std::ios::trunc};
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.record_size = sizeof(Record);
+    header.block_records = BLOCK_RECORDS;
+    header.key_schema = zobrist::SCHEMA;
+    index.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<zobrist::key_type> fences;
+    std::uint64_t count = 0;
+    Record pending{};
+    bool has_pending = false;
+
+    auto write_record = [&](const Record& record){
+        if (count % BLOCK_RECORDS == 0)
+            fences.push_back(record.key);
+        index.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        ++count;
+    };
+
+    while (!heads.empty())
+    {
+        const auto [record, run] = heads.top();
+        heads.pop();
+        advance(run);
+
+        if (has_pending && same_entry(pending, record))
+        {
+            pending.white_wins += record.white_wins;
+            pending.draws += record.draws;
+            pending.black_wins += record.black_wins;
+            continue;
+        }
+        if (has_pending)
+            write_record(pending);
+        pending = record;
+        has_pending = true;
+    }
+    if (has_pending)
+        write_record(pending);
+
+    index.write(reinterpret_cast<const char*>(fences.data()), fences.size() * sizeof(zobrist::key_type));
+
+    header.record_count = count;
+    index.seekp(0);
+    index.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!index)
+        throw IndexWriteError;
+
+    files.clear();
+    for (const auto& path : runs)
+        std::remove(path.c_str());
+    runs.clear();
+
+    return count;
+}
+
+explorer::Index::Index(const std::string& path)
+    :file(path)
+{
+    const std::string_view data = file.data();
+    if (data.size() < sizeof(Header))
+        throw BadIndexError;
+
+    Header header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+        || header.record_size != sizeof(Record) || header.block_records != BLOCK_RECORDS || header.key_schema != zobrist::SCHEMA)
+        throw BadIndexError;
+
+    record_count = header.record_count;
+    fence_count = (record_count + BLOCK_RECORDS - 1) / BLOCK_RECORDS;
+    if (data.size() != sizeof(Header) + record_count * sizeof(Record) + fence_count * sizeof(zobrist::key_type))
+        throw BadIndexError;
+
+    // the mapping is page aligned and the header keeps records and fences 8 byte aligned
+    records = reinterpret_cast<const Record*>(data.data() + sizeof(Header));
+    fences = reinterpret_cast<const zobrist::key_type*>(data.data() + sizeof(Header) + record_count * sizeof(Record));
+}
+
+std::vector<explorer::Continuation> explorer::Index::continuations(zobrist::key_type key) const
+{
+    std::vector<Continuation> result;
+    if (record_count == 0)
+        return result;
+
+    // entries of key start in the block before the first fence not below key
+    const std::uint64_t block = std::lower_bound(fences, fences + fence_count, key) - fences;
+    const std::uint64_t first = (block == 0) ? 0 : (block - 1) * BLOCK_RECORDS;
+    const std::uint64_t last = std::min(record_count, std::max<std::uint64_t>(block, 1) * BLOCK_RECORDS);
+
+    const Record* entry = std::lower_bound(records + first, records + last, key,
+                                           [](const Record& record, zobrist::key_type k){ return record.key < k; });
+
+    for (; entry != records + record_count && entry->key == key; ++entry)
+        result.push_back(Continuation{cbn::ChessNotation{square_of_index(entry->from), square_of_index(entry->to)},
+                                      entry->white_wins, entry->draws, entry->black_wins});
+    return result;
+}
@@ -0,0 +1,508 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CHESS_NNUE_AVX2
+#include <immintrin.h>
+#endif
+
+#include "chess_board.hpp"
+#include "Exception.hpp"
+#include "MappedFile.hpp"
+
+/*
+Efficiently updatable neural network evaluation
+
+HalfKP features: for each side (perspective) every non king piece is one input, indexed by
+the square of the perspective's king, the kind of the piece seen from the perspective and its square
+Squares are flipped for black, so both perspectives see their own back rank first
+
+    2 x HALF_DIMENSIONS int16 accumulator --> clipped relu --> HIDDEN_DIMENSIONS --> clipped relu --> HIDDEN_DIMENSIONS --> 1
+
+The accumulator of a perspective is the sum of the weight rows of its active features,
+so a move only adds and subtracts the rows of the pieces it changes. Moving a king changes every
+feature of its own perspective, that perspective is summed again from the board
+The layers after the accumulator use int8 weights on uint8 activations
+
+Kernels are picked once at startup: AVX2 if the cpu has it, portable scalar code otherwise
+Both compute exactly the same numbers
+*/
+
+namespace nnue
+{
+    const int HALF_DIMENSIONS = 256;
+    const int HIDDEN_DIMENSIONS = 32;
+
+    const int SQUARES = chess_constants::CHESS_BOARD_SIZE * chess_constants::CHESS_BOARD_SIZE;
+    const int PIECE_KINDS = 10;    // pawn, knight, bishop, rook and queen of the perspective and of the enemy
+    const int INPUT_DIMENSIONS = SQUARES * PIECE_KINDS * SQUARES;
+
+    const int WEIGHT_SCALE_BITS = 6;       // hidden layer sums are shifted right by this
+    const int MAX_ACTIVATION = 127;        // clipped relu range is [0, MAX_ACTIVATION]
+    const int OUTPUT_SCALE = 16;           // network output per centipawn
+    const double CENTIPAWNS = 100;         // centipawns per pawn, the unit of the search
+
+    const int MAX_CHANGES = 3;  // a search move takes the mover and a captured piece off and puts the (promoted) mover on
+
+    const char MAGIC[8] = {'C', 'H', 'E', 'S', 'S', 'N', 'N', '\0'};
+    const std::uint32_t VERSION = 1;
+
+    const Exception BadNetworkError{"BadNetworkError: File Is Not A Network Of This Architecture"};
+    const Exception NetworkWriteError{"NetworkWriteError: Network Can Not Be Written"};
+
+    struct NetworkHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t half_dimensions;
+        std::uint32_t hidden_dimensions;
+        std::uint32_t input_dimensions;
+    };
+
+    struct Network
+    // parameters in file order, weight rows are stored one after another
+    {
+        std::vector<std::int16_t> feature_biases;   // HALF_DIMENSIONS
+        std::vector<std::int16_t> feature_weights;  // INPUT_DIMENSIONS rows of HALF_DIMENSIONS
+        std::vector<std::int32_t> hidden1_biases;   // HIDDEN_DIMENSIONS
+        std::vector<std::int8_t> hidden1_weights;   // HIDDEN_DIMENSIONS rows of 2 * HALF_DIMENSIONS
+        std::vector<std::int32_t> hidden2_biases;   // HIDDEN_DIMENSIONS
+        std::vector<std::int8_t> hidden2_weights;   // HIDDEN_DIMENSIONS rows of HIDDEN_DIMENSIONS
+        std::int32_t output_bias = 0;
+        std::vector<std::int8_t> output_weights;    // HIDDEN_DIMENSIONS
+    };
+
+    // return network with every parameter zero, sized for the architecture
+    Network empty_network();
+
+    // return network read from path, throws BadNetworkError
+    std::shared_ptr<const Network> load_network(const std::string& path);
+
+    // throws NetworkWriteError
+    void save_network(const Network& network, const std::string& path);
+
+    struct Kernels
+    {
+        const char* name;
+        void (*add_row)(std::int16_t* accumulator, const std::int16_t* row);    // HALF_DIMENSIONS values
+        void (*sub_row)(std::int16_t* accumulator, const std::int16_t* row);
+        // return sum of input[i] * weights[i], size is a multiple of 32
+        std::int32_t (*dot)(const std::uint8_t* input, const std::int8_t* weights, int size);
+    };
+
+    Kernels scalar_kernels();
+
+    // return AVX2 kernels if the cpu supports them, scalar ones otherwise
+    Kernels select_kernels();
+
+    const Kernels KERNELS = select_kernels();
+
+    struct FeatureChange
+    {
+        cbn::Piece piece;
+        cbn::ChessCoordinate square;
+        bool added;
+    };
+
+    struct Accumulator
+    {
+        alignas(32) std::array<std::array<std::int16_t, HALF_DIMENSIONS>, 2> values;  // indexed by perspective
+        std::array<bool, 2> computed{};
+        std::array<int, 2> king_square{};
+
+        // changes of the move leading here from the previous ply
+        std::array<FeatureChange, MAX_CHANGES> changes;
+        int change_count = 0;
+    };
+
+    // return input index of piece on square seen from perspective with its king on king_square
+    int feature_index(const cbn::Piece_color& perspective, int king_square, const cbn::Piece& piece, const cbn::ChessCoordinate& square);
+
+    // return square index seen from perspective, its back rank comes first
+    int oriented_square(const cbn::Piece_color& perspective, const cbn::ChessCoordinate& square);
+
+    class Evaluator{
+    public:
+        // plies --> deepest ply evaluate will be called with plus one
+        Evaluator(std::shared_ptr<const Network> n, std::size_t plies)
+            :network(std::move(n)), stack(network ? plies : 0)    {   }
+
+        // return false without a network, push_move and reset do nothing then
+        bool active() const { return network != nullptr; }
+
+        // forget every accumulator, the next root is a new position
+        void reset();
+
+        // record move, not yet played on board, as the change from ply to ply + 1
+        void push_move(const cbn::ChessBoard& board, const cbn::ChessNotation& move, int ply);
+
+        // ply + 1 has the pieces of ply
+        void push_null(int ply);
+
+        // return score of board seen from its moving color in pawns, board is the position reached at ply
+        double evaluate(const cbn::ChessBoard& board, int ply);
+
+    private:
+        // bring the accumulator of perspective at ply up to date
+        void update(const cbn::ChessBoard& board, int ply, int perspective);
+
+        void refresh(const cbn::ChessBoard& board, Accumulator& accumulator, int perspective);
+
+        std::shared_ptr<const Network> network;
+        std::vector<Accumulator> stack;     // accumulator of every ply of the running search
+    };
+}
+
+/**************************************************************************************Function definition*******************************************************************/
+
+nnue::Network nnue::empty_network()
+{
+    Network network;
+    network.feature_biases.assign(HALF_DIMENSIONS, 0);
+    network.feature_weights.assign(static_cast<std::size_t>(INPUT_DIMENSIONS) * HALF_DIMENSIONS, 0);
+    network.hidden1_biases.assign(HIDDEN_DIMENSIONS, 0);
+    network.hidden1_weights.assign(HIDDEN_DIMENSIONS * 2 * HALF_DIMENSIONS, 0);
+    network.hidden2_biases.assign(HIDDEN_DIMENSIONS, 0);
+    network.hidden2_weights.assign(HIDDEN_DIMENSIONS * HIDDEN_DIMENSIONS, 0);
+    network.output_weights.assign(HIDDEN_DIMENSIONS, 0);
+    return network;
+}
+
+std::shared_ptr<const nnue::Network> nnue::load_network(const std::string& path)
+{
+    std::unique_ptr<io::MappedFile> file;
+    try {
+        file = std::make_unique<io::MappedFile>(path);
+    }
+    catch (Exception&)
+    {
+        throw BadNetworkError;
+    }
+
+    auto network = std::make_shared<Network>(empty_network());
+    const std::string_view data = file->data();
+    std::size_t offset = 0;
+
+    auto read = [&data, &offset](void* destination, std::size_t size){
+        if (offset + size > data.size())
+            throw BadNetworkError;
+        std::memcpy(destination, data.data() + offset, size);
+        offset += size;
+    };
+    auto read_vector = [&read](auto& values){
+        read(values.data(), values.size() * sizeof(values[0]));
+    };
+
+    NetworkHeader header;
+    read(&header, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+        || header.half_dimensions != HALF_DIMENSIONS || header.hidden_dimensions != HIDDEN_DIMENSIONS
+        || header.input_dimensions != INPUT_DIMENSIONS)
+        throw BadNetworkError;
+
+    read_vector(network->feature_biases);
+    read_vector(network->feature_weights);
+    read_vector(network->hidden1_biases);
+    read_vector(network->hidden1_weights);
+    read_vector(network->hidden2_biases);
+    read_vector(network->hidden2_weights);
+    read(&network->output_bias, sizeof(network->output_bias));
+    read_vector(network->output_weights);
+
+    if (offset != data.size())
+        throw BadNetworkError;
+    return network;
+}
+
+void nnue::save_network(const Network& network, const std::string& path)
+{
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+
+    auto write_vector = [&file](const auto& values){
+        file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(values[0]));
+    };
+
+    NetworkHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.half_dimensions = HALF_DIMENSIONS;
+    header.hidden_dimensions = HIDDEN_DIMENSIONS;
+    header.input_dimensions = INPUT_DIMENSIONS;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    write_vector(network.feature_biases);
+    write_vector(network.feature_weights);
+    write_vector(network.hidden1_biases);
+    write_vector(network.hidden1_weights);
+    write_vector(network.hidden2_biases);
+    write_vector(network.hidden2_weights);
+    file.write(reinterpret_cast<const char*>(&network.output_bias), sizeof(network.output_bias));
+    write_vector(network.output_weights);
+
+    if (!file)
+        throw NetworkWriteError;
+}
+
+nnue::Kernels nnue::scalar_kernels()
+{
+    Kernels kernels;
+    kernels.name = "scalar";
+    kernels.add_row = [](std::int16_t* accumulator, const std::int16_t* row){
+        for (int i = 0; i < HALF_DIMENSIONS; ++i)
+            accumulator[i] += row[i];
+    };
+    kernels.sub_row = [](std::int16_t* accumulator, const std::int16_t* row){
+        for (int i = 0; i < HALF_DIMENSIONS; ++i)
+            accumulator[i] -= row[i];
+    };
+    kernels.dot = [](const std::uint8_t* input, const std::int8_t* weights, int size){
+        std::int32_t sum = 0;
+        for (int i = 0; i < size; ++i)
+            sum += static_cast<std::int32_t>(input[i]) * weights[i];
+        return sum;
+    };
+    return kernels;
+}
+
+#ifdef CHESS_NNUE_AVX2
+
+namespace nnue
+{
+    __attribute__((target("avx2")))
+    void add_row_avx2(std::int16_t* accumulator, const std::int16_t* row)
+    {
+        for (int i = 0; i < HALF_DIMENSIONS; i += 16)
+        {
+            __m256i* target = reinterpret_cast<__m256i*>(accumulator + i);
+            const __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+            _mm256_store_si256(target, _mm256_add_epi16(_mm256_load_si256(target), values));
+        }
+    }
+
+    __attribute__((target("avx2")))
+    void sub_row_avx2(std::int16_t* accumulator, const std::int16_t* row)
+    {
+        for (int i = 0; i < HALF_DIMENSIONS; i += 16)
+        {
+            __m256i* target = reinterpret_cast<__m256i*>(accumulator + i);
+            const __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+            _mm256_store_si256(target, _mm256_sub_epi16(_mm256_load_si256(target), values));
+        }
+    }
+
+    __attribute__((target("avx2")))
+    std::int32_t dot_avx2(const std::uint8_t* input, const std::int8_t* weights, int size)
+    // activations are at most 127 --> the pairwise int16 sums of maddubs can not saturate
+    {
+        const __m256i ones = _mm256_set1_epi16(1);
+        __m256i sum = _mm256_setzero_si256();
+
+        for (int i = 0; i < size; i += 32)
+        {
+            const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+            const __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(in, w), ones));
+        }
+
+        __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0x4E));
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0xB1));
+        return _mm_cvtsi128_si32(total);
+    }
+}
+
+#endif
+
+nnue::Kernels nnue::select_kernels()
+{
+#ifdef CHESS_NNUE_AVX2
+    if (__builtin_cpu_supports("avx2"))
+        return Kernels{"avx2", add_row_avx2, sub_row_avx2, dot_avx2};
+#endif
+    return scalar_kernels();
+}
+
+int nnue::oriented_square(const cbn::Piece_color& perspective, const cbn::ChessCoordinate& square)
+{
+    const int row = (perspective == cbn::Piece_color::White) ? cbn::WHITE_BACK_RANK - square.integer : square.integer - cbn::BLACK_BACK_RANK;
+    return row * cbn::CHESS_BOARD_SIZE + square.character;
+}
+
+int nnue::feature_index(const cbn::Piece_color& perspective, int king_square, const cbn::Piece& piece, const cbn::ChessCoordinate& square)
+// Pre-Condition: piece is neither empty nor a king
+{
+    int kind = 0;
+    switch (piece.type)
+    {
+        case cbn::Piece_type::Pawn:     kind = 0; break;
+        case cbn::Piece_type::Knight:   kind = 1; break;
+        case cbn::Piece_type::Bishop:   kind = 2; break;
+        case cbn::Piece_type::Rook:     kind = 3; break;
+        default:                        kind = 4; break;
+    }
+    if (piece.color != perspective)
+        kind += PIECE_KINDS / 2;
+
+    return (king_square * PIECE_KINDS + kind) * SQUARES + oriented_square(perspective, square);
+}
+
+void nnue::Evaluator::reset()
+{
+    if (!active())
+        return;
+    for (auto& accumulator : stack)
+    {
+        accumulator.computed.fill(false);
+        accumulator.change_count = 0;
+    }
+}
+
+void nnue::Evaluator::push_move(const cbn::ChessBoard& board, const cbn::ChessNotation& move, int ply)
+// the search plays moves with TemporalMove --> the mover leaves from, takes whatever is on to and may be promoted
+{
+    if (!active())
+        return;
+
+    Accumulator& next = stack[ply + 1];
+    next.computed.fill(false);
+    next.change_count = 0;
+
+    const cbn::Piece& mover = board[move.from];
+    const cbn::Piece& captured = board[move.to];
+
+    next.changes[next.change_count++] = FeatureChange{mover, move.from, false};
+    if (!cbn::is_empty(captured))
+        next.changes[next.change_count++] = FeatureChange{captured, move.to, false};
+    next.changes[next.change_count++] = FeatureChange{cbn::promoted(mover, move.to), move.to, true};
+}
+
+void nnue::Evaluator::push_null(int ply)
+{
+    if (!active())
+        return;
+
+    Accumulator& next = stack[ply + 1];
+    next.computed.fill(false);
+    next.change_count = 0;
+}
+
+void nnue::Evaluator::refresh(const cbn::ChessBoard& board, Accumulator& accumulator, int perspective)
+{
+    const cbn::Piece_color color = static_cast<cbn::Piece_color>(perspective);
+    std::int16_t* values = accumulator.values[perspective].data();
+
+    for (int rank_index = 0; rank_index < cbn::CHESS_BOARD_SIZE; ++rank_index)
+        for (int piece_index = 0; piece_index < cbn::CHESS_BOARD_SIZE; ++piece_index)
+        {
+            const cbn::ChessCoordinate current{piece_index, rank_index};
+            const cbn::Piece& piece = board[current];
+            if (piece.type == cbn::Piece_type::King && piece.color == color)
+                accumulator.king_square[perspective] = oriented_square(color, current);
+        }
+
+    std::copy(network->feature_biases.begin(), network->feature_biases.end(), values);
+
+    for (int rank_index = 0; rank_index < cbn::CHESS_BOARD_SIZE; ++rank_index)
+        for (int piece_index = 0; piece_index < cbn::CHESS_BOARD_SIZE; ++piece_index)
+        {
+            const cbn::ChessCoordinate current{piece_index, rank_index};
+            const cbn::Piece& piece = board[current];
+            if (cbn::is_empty(piece) || piece.type == cbn::Piece_type::King)
+                continue;
+
+            const int index = feature_index(color, accumulator.king_square[perspective], piece, current);
+            KERNELS.add_row(values, network->feature_weights.data() + static_cast<std::size_t>(index) * HALF_DIMENSIONS);
+        }
+
+    accumulator.computed[perspective] = true;
+}
+
+void nnue::Evaluator::update(const cbn::ChessBoard& board, int ply, int perspective)
+// walk back to the last computed accumulator and replay the changes from there,
+// a move of the perspective's king on the way makes a refresh cheaper
+{
+    const cbn::Piece_color color = static_cast<cbn::Piece_color>(perspective);
+
+    int start = ply;
+    while (!stack[start].computed[perspective])
+    {
+        const Accumulator& accumulator = stack[start];
+        const bool own_king_moved = accumulator.change_count > 0
+            && accumulator.changes[0].piece.type == cbn::Piece_type::King && accumulator.changes[0].piece.color == color;
+
+        if (start == 0 || own_king_moved)
+        {
+            refresh(board, stack[ply], perspective);
+            return;
+        }
+        --start;
+    }
+
+    for (int current = start + 1; current <= ply; ++current)
+    {
+        Accumulator& accumulator = stack[current];
+        const Accumulator& previous = stack[current - 1];
+
+        accumulator.values[perspective] = previous.values[perspective];
+        accumulator.king_square[perspective] = previous.king_square[perspective];
+        std::int16_t* values = accumulator.values[perspective].data();
+
+        for (int i = 0; i < accumulator.change_count; ++i)
+        {
+            const FeatureChange& change = accumulator.changes[i];
+            if (change.piece.type == cbn::Piece_type::King)
+                continue;
+
+            const int index = feature_index(color, accumulator.king_square[perspective], change.piece, change.square);
+            const std::int16_t* row = network->feature_weights.data() + static_cast<std::size_t>(index) * HALF_DIMENSIONS;
+            if (change.added)
+                KERNELS.add_row(values, row);
+            else
+                KERNELS.sub_row(values, row);
+        }
+        accumulator.computed[perspective] = true;
+    }
+}
+
+double nnue::Evaluator::evaluate(const cbn::ChessBoard& board, int ply)
+{
+    const int us = static_cast<int>(board.colors_turn());
+    const int them = 1 - us;
+
+    update(board, ply, us);
+    update(board, ply, them);
+
+    const Accumulator& accumulator = stack[ply];
+
+    // the moving color's half comes first
+    alignas(32) std::array<std::uint8_t, 2 * HALF_DIMENSIONS> transformed;
+    for (int i = 0; i < HALF_DIMENSIONS; ++i)
+    {
+        transformed[i] = static_cast<std::uint8_t>(std::clamp<int>(accumulator.values[us][i], 0, MAX_ACTIVATION));
+        transformed[HALF_DIMENSIONS + i] = static_cast<std::uint8_t>(std::clamp<int>(accumulator.values[them][i], 0, MAX_ACTIVATION));
+    }
+
+    auto hidden_layer = [](const std::uint8_t* input, int size, const std::vector<std::int32_t>& biases,
+                           const std::vector<std::int8_t>& weights, std::uint8_t* output){
+        for (int i = 0; i < HIDDEN_DIMENSIONS; ++i)
+        {
+            const std::int32_t sum = biases[i] + KERNELS.dot(input, weights.data() + i * size, size);
+            output[i] = static_cast<std::uint8_t>(std::clamp(sum >> WEIGHT_SCALE_BITS, 0, MAX_ACTIVATION));
+        }
+    };
+
+    alignas(32) std::array<std::uint8_t, HIDDEN_DIMENSIONS> hidden1, hidden2;
+    hidden_layer(transformed.data(), 2 * HALF_DIMENSIONS, network->hidden1_biases, network->hidden1_weights, hidden1.data());
+    hidden_layer(hidden1.data(), HIDDEN_DIMENSIONS, network->hidden2_biases, network->hidden2_weights, hidden2.data());
+
+    const std::int32_t output = network->output_bias + KERNELS.dot(hidden2.data(), network->output_weights.data(), HIDDEN_DIMENSIONS);
+    return output / static_cast<double>(OUTPUT_SCALE) / CENTIPAWNS;
+}
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cctype>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <assert.h>
 
 #include "Exception.hpp"
@@ -30,22 +34,18 @@ namespace chess_notation
     const Exception EmptySquareError{"EmptySquareError: Location Does Not Contain Any Pieces"};
 
     struct ChessCoordinate{
-        ChessCoordinate ()
+        ChessCoordinate () noexcept
             :character(CHESSCOORDINATE_INVALID_VALUE), integer(CHESSCOORDINATE_INVALID_VALUE) {   }
 
-        ChessCoordinate(int c, int i) 
+        ChessCoordinate(int c, int i) noexcept
         {    
             character = c;
             integer = i;
         }
 
-        ChessCoordinate(const ChessCoordinate& c)
-        {
-            character = c.character;
-            integer = c.integer;
-        }
+        ChessCoordinate(const ChessCoordinate& c) = default;
 
-        bool is_valid() const
+        bool is_valid() const noexcept
         {
             if (!(MIN_INDEX <= character && character <= MAX_INDEX))
                 return false;
@@ -88,17 +88,31 @@ namespace chess_notation
         return is;
     } 
 
-    bool operator==(const ChessCoordinate& x, const ChessCoordinate& y)
+    std::string square_name(const ChessCoordinate& location)
+    // return name of location in standard algebraic notation (FEN, SAN), its ranks count from the white back rank
+    {
+        return std::string{static_cast<char>(ALPHABET_TO_INT + location.character), static_cast<char>('8' - location.integer)};
+    }
+
+    ChessCoordinate square_from_name(const std::string& name)
+    // return location named in standard algebraic notation, invalid coordinate if name is none
+    {
+        if (name.size() != 2)
+            return ChessCoordinate{};
+        return ChessCoordinate{name[0] - ALPHABET_TO_INT, '8' - name[1]};
+    }
+
+    bool operator==(const ChessCoordinate& x, const ChessCoordinate& y) noexcept
     {
         return ((x.character == y.character) && (x.integer == y.integer));
     }
 
-    bool operator!=(const ChessCoordinate& x, const ChessCoordinate& y)
+    bool operator!=(const ChessCoordinate& x, const ChessCoordinate& y) noexcept
     {
         return !operator==(x,y);
     }
 
-    bool operator<(const ChessCoordinate& x, const ChessCoordinate& y)
+    bool operator<(const ChessCoordinate& x, const ChessCoordinate& y) noexcept
     {
         if (x.character < y.character)
             return true;
@@ -111,7 +125,7 @@ namespace chess_notation
         return false;
     }
 
-    bool operator>(const ChessCoordinate& x, const ChessCoordinate& y)
+    bool operator>(const ChessCoordinate& x, const ChessCoordinate& y) noexcept
     {
         if (x.character > y.character)
             return true;
@@ -124,7 +138,7 @@ namespace chess_notation
         return false;
     }
 
-    bool operator<=(const ChessCoordinate& x, const ChessCoordinate& y)
+    bool operator<=(const ChessCoordinate& x, const ChessCoordinate& y) noexcept
     {
         if (x == y)
             return true;
@@ -132,7 +146,7 @@ namespace chess_notation
             return x < y;
     }
 
-    bool operator>=(const ChessCoordinate& x, const ChessCoordinate& y)
+    bool operator>=(const ChessCoordinate& x, const ChessCoordinate& y) noexcept
     {
         if (x == y)
             return true;
@@ -140,33 +154,36 @@ namespace chess_notation
             return x > y;
     }
 
-    ChessCoordinate operator+(const ChessCoordinate& location, const ChessCoordinate& relocation)
+    ChessCoordinate operator+(const ChessCoordinate& location, const ChessCoordinate& relocation) noexcept
     {
         return ChessCoordinate{location.character + relocation.character, location.integer + relocation.integer};
     }
 
-    ChessCoordinate operator-(const ChessCoordinate& location, const ChessCoordinate& relocation)
+    ChessCoordinate operator-(const ChessCoordinate& location, const ChessCoordinate& relocation) noexcept
     {
         return ChessCoordinate{location.character - relocation.character, location.integer - relocation.integer};
     }
 
-    ChessCoordinate& operator+=(ChessCoordinate& location, const ChessCoordinate& shift)
+    ChessCoordinate& operator+=(ChessCoordinate& location, const ChessCoordinate& shift) noexcept
     {
         location.character += shift.character;
         location.integer += shift.integer;
         return location;
     }
 
-    ChessCoordinate& operator-=(ChessCoordinate& location, const ChessCoordinate& shift)
+    ChessCoordinate& operator-=(ChessCoordinate& location, const ChessCoordinate& shift) noexcept
     {
         location.character -= shift.character;
         location.integer -= shift.integer;
         return location;
     }
 
+    struct Unchecked {};
+    const Unchecked UNCHECKED{};    // marks moves made of squares a generator produced, they are not validated again
+
     struct ChessNotation
     {
-        ChessNotation()
+        ChessNotation() noexcept
             :from(ChessCoordinate{}), to(ChessCoordinate{}) {   }
 
         ChessNotation(const ChessCoordinate& f, const ChessCoordinate& t)
@@ -177,10 +194,46 @@ namespace chess_notation
             assert(from != to);
         }
 
+        // Pre-Condition: f and t are different squares of the board
+        ChessNotation(const ChessCoordinate& f, const ChessCoordinate& t, Unchecked) noexcept
+            :from(f), to(t) {   }
+
         ChessCoordinate from;  // move from x
         ChessCoordinate to;  // to y
     };
 
+    std::optional<ChessCoordinate> parse_coordinate(std::string_view text) noexcept
+    // return square of input like "e2", its rank counts like operator>> does, nullopt if text is none
+    {
+        if (text.size() != 2 || !std::isalpha(static_cast<unsigned char>(text[0])) || !std::isdigit(static_cast<unsigned char>(text[1])))
+            return std::nullopt;
+
+        const ChessCoordinate location{std::tolower(static_cast<unsigned char>(text[0])) - ALPHABET_TO_INT, text[1] - '0' - INDEX_TO_NUM};
+        if (!location.is_valid())
+            return std::nullopt;
+        return location;
+    }
+
+    std::optional<ChessNotation> parse_move(std::string_view text) noexcept
+    // return move of input like "e2e4" or "e2 e4", nullopt if text is none or both squares are the same
+    {
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front())))
+            text.remove_prefix(1);
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back())))
+            text.remove_suffix(1);
+
+        std::string_view from_text = text.substr(0, 2);
+        std::string_view to_text = text.substr(std::min<std::size_t>(2, text.size()));
+        if (!to_text.empty() && to_text.front() == ' ')
+            to_text.remove_prefix(1);
+
+        const auto from = parse_coordinate(from_text);
+        const auto to = parse_coordinate(to_text);
+        if (!from || !to || *from == *to)
+            return std::nullopt;
+        return ChessNotation{*from, *to, UNCHECKED};
+    }
+
     std::ostream& operator<<(std::ostream& os, const ChessNotation& notation)
     {
         return os << "From: " << notation.from << " To: " << notation.to; 
@@ -194,12 +247,12 @@ namespace chess_notation
         return is; 
     } 
 
-    bool operator==(const ChessNotation& x, const ChessNotation& y)
+    bool operator==(const ChessNotation& x, const ChessNotation& y) noexcept
     {
         return (x.from == y.from && x.to == y.to);
     }
 
-    bool operator!=(const ChessNotation& x, const ChessNotation& y)
+    bool operator!=(const ChessNotation& x, const ChessNotation& y) noexcept
     {
         return !operator==(x, y);
     }
@@ -0,0 +1,526 @@
+#pragma once
+
+#include <cctype>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "chess_board.hpp"
+#include "Exception.hpp"
+
+/*
+Portable game notation
+
+Moves are written in standard algebraic notation (SAN), squares are named from the white side
+like in FEN --> the white e pawn starts on e2 here while the board prints it on e7
+The Reader walks over text in memory (e.g. a MappedFile) without copying it,
+records handed to it are reused so reading a game does not allocate once they grew
+*/
+
+namespace pgn
+{
+    const int LINE_LENGTH = 80;     // movetext is wrapped before this column
+
+    const Exception BadSanError{"BadSanError: Move Is Not A Single Legal Move Of The Position"};
+    const Exception UnderpromotionError{"UnderpromotionError: Pawns Can Only Be Promoted To Queens"};
+
+    struct GameRecord
+    {
+        std::vector<std::pair<std::string, std::string>> tags;    // in output order, the seven tag roster first
+        std::vector<std::string> moves;                             // SAN of every ply
+        std::string result = "*";                                   // 1-0, 0-1, 1/2-1/2 or *
+    };
+
+    // return SAN of move, board is the position before move
+    std::string san(cbn::ChessBoard& board, const cbn::ChessNotation& move);
+
+    // return result tag of color losing or 1/2-1/2 if color is neutral
+    std::string result_of_loser(const cbn::Piece_color& loser);
+
+    void write_game(std::ostream& os, const GameRecord& game);
+
+    // return the legal move of board named by san, throws BadSanError or UnderpromotionError
+    cbn::ChessNotation parse_san(cbn::ChessBoard& board, std::string_view san);
+
+    // same as above, legal is bound to board --> its masks are shared with the caller
+    cbn::ChessNotation parse_san(cbn::ChessBoard& board, lmn::Legalmoves& legal, std::string_view san);
+
+    // return true if a piece of type on from could reach to on an empty board, castling aside
+    bool reaches(const cbn::Piece_type& type, const cbn::ChessCoordinate& from, const cbn::ChessCoordinate& to);
+
+    // return position the game starts from, its FEN tag or the initial position
+    cbn::ChessBoard start_position(const GameRecord& game);
+
+    // call visit(board, move) for every move of game before playing it on board, throws like parse_san
+    template <typename Visit>
+    void replay(const GameRecord& game, cbn::ChessBoard& board, Visit visit);
+
+    class Reader{
+    public:
+        explicit Reader(std::string_view t)
+            :text(t) {   }
+
+        // read the next game into game, return false when text is used up
+        bool next(GameRecord& game);
+
+        // return bytes of text read so far
+        std::size_t position() const { return pos; }
+
+    private:
+        void skip_space();
+
+        void skip_comment(char end);
+
+        void skip_variation();
+
+        std::string_view read_token();
+
+        std::string_view read_quoted();
+
+        std::string_view text;
+        std::size_t pos = 0;
+    };
+
+    // return true if token ends a game
+    bool is_result(std::string_view token);
+}
+
+/**************************************************************************************Function definition*******************************************************************/
+
+std::string pgn::san(cbn::ChessBoard& board, const cbn::ChessNotation& move)
+{
+    const cbn::Piece piece = board[move.from];
+    std::string text;
+
+    if (board.is_castle(move))
+        text = (move.to.character == cbn::RIGHT_CASTLE_CHARACTER) ? "O-O" : "O-O-O";
+    else
+    {
+        const bool capture = !cbn::is_empty(board[move.to])
+                             || (piece.type == cbn::Piece_type::Pawn && move.from.character != move.to.character);
+
+        if (piece.type == cbn::Piece_type::Pawn)
+        {
+            if (capture)
+                text += cbn::square_name(move.from)[0];
+        }
+        else
+        {
+            text += cbn::PIECE_LETTERS[static_cast<int>(piece.type)];
+
+            // other pieces of the same kind reaching move.to --> name file, rank or both of move.from
+            bool ambiguous = false, same_file = false, same_rank = false;
+            lmn::Legalmoves legal{board};
+
+            for (int row_i = 0; row_i < cbn::CHESS_BOARD_SIZE; ++row_i)
+            {
+                for (int piece_i = 0; piece_i < cbn::CHESS_BOARD_SIZE; ++piece_i)
+                {
+                    const cbn::ChessCoordinate other{piece_i, row_i};
+                    if (other == move.from || board[other].type != piece.type || board[other].color != piece.color)
+                        continue;
+
+                    if (!cbn::move_is_legal(legal.get_legal_moves(other), cbn::ChessNotation{other, move.to, cbn::UNCHECKED}))
+                        continue;
+
+                    ambiguous = true;
+                    same_file |= other.character == move.from.character;
+                    same_rank |= other.integer == move.from.integer;
+                }
+            }
+
+            const std::string from = cbn::square_name(move.from);
+            if (ambiguous && !same_file)
+                text += from[0];
+            else if (ambiguous && !same_rank)
+                text += from[1];
+            else if (ambiguous)
+                text += from;
+        }
+
+        if (capture)
+            text += 'x';
+        text += cbn::square_name(move.to);
+
+        if (cbn::promoted(piece, move.to).type != piece.type)
+            text += "=Q";
+    }
+
+    // check and mate are seen after the move
+    cbn::ChessBoard after = board;
+    lmn::Legalmoves legal{after};
+    after.move(legal.get_legal_moves(move.from), move);
+
+    if (after.is_checked(after.colors_turn()))
+        text += after.has_any_legal_move(after.colors_turn()) ? '+' : '#';
+
+    return text;
+}
+
+std::string pgn::result_of_loser(const cbn::Piece_color& loser)
+{
+    if (loser == cbn::Piece_color::White)
+        return "0-1";
+    if (loser == cbn::Piece_color::Black)
+        return "1-0";
+    return "1/2-1/2";
+}
+
+void pgn::write_game(std::ostream& os, const GameRecord& game)
+{
+    for (const auto& [name, value] : game.tags)
+        os << '[' << name << " \"" << value << "\"]\n";
+    os << '\n';
+
+    // move numbers count from the position given in the FEN tag
+    int move_number = 1;
+    bool black_first = false;
+    for (const auto& [name, value] : game.tags)
+    {
+        if (name != "FEN")
+            continue;
+
+        cbn::ChessBoard start{value};
+        const std::string fen = start.fen();
+        black_first = start.colors_turn() == cbn::Piece_color::Black;
+        move_number = std::stoi(fen.substr(fen.find_last_of(' ') + 1));
+    }
+
+    std::string line;
+    auto append = [&os, &line](const std::string& word){
+        if (!line.empty() && line.size() + 1 + word.size() >= static_cast<std::size_t>(LINE_LENGTH))
+        {
+            os << line << '\n';
+            line.clear();
+        }
+        if (!line.empty())
+            line += ' ';
+        line += word;
+    };
+
+    for (std::size_t ply = 0; ply < game.moves.size(); ++ply)
+    {
+        const bool white_moves = (ply % 2 == 0) != black_first;
+
+        if (white_moves)
+            append(std::to_string(move_number) + ".");
+        else if (ply == 0)
+            append(std::to_string(move_number) + "...");
+
+        append(game.moves[ply]);
+
+        if (!white_moves)
+            ++move_number;
+    }
+    append(game.result);
+
+    os << line << "\n\n";
+}
+
+cbn::ChessNotation pgn::parse_san(cbn::ChessBoard& board, std::string_view san)
+{
+    lmn::Legalmoves legal{board};
+    return parse_san(board, legal, san);
+}
+
+bool pgn::reaches(const cbn::Piece_type& type, const cbn::ChessCoordinate& from, const cbn::ChessCoordinate& to)
+{
+    const int dx = std::abs(to.character - from.character);
+    const int dy = std::abs(to.integer - from.integer);
+
+    switch (type)
+    {
+        case cbn::Piece_type::Pawn:   return dx <= 1 && dy <= 2;
+        case cbn::Piece_type::Knight: return dx * dy == 2;
+        case cbn::Piece_type::Bishop: return dx == dy;
+        case cbn::Piece_type::Rook:   return dx == 0 || dy == 0;
+        case cbn::Piece_type::Queen:  return dx == dy || dx == 0 || dy == 0;
+        case cbn::Piece_type::King:   return dx <= 1 && dy <= 1;
+        default:                      return false;
+    }
+}
+
+cbn::ChessNotation pgn::parse_san(cbn::ChessBoard& board, lmn::Legalmoves& legal, std::string_view san)
+{
+    // annotations and check marks say nothing about the move
+    while (!san.empty() && std::string_view{"+#!?"}.find(san.back()) != std::string_view::npos)
+        san.remove_suffix(1);
+
+    const cbn::Piece_color us = board.colors_turn();
+    const int back_rank = (us == cbn::Piece_color::White) ? cbn::WHITE_BACK_RANK : cbn::BLACK_BACK_RANK;
+
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0")
+    {
+        const int castle_character = (san.size() == 3) ? cbn::RIGHT_CASTLE_CHARACTER : cbn::LEFT_CASTLE_CHARACTER;
+        const cbn::ChessNotation move{{cbn::KING_CHARACTER, back_rank}, {castle_character, back_rank}};
+
+        if (board[move.from].type != cbn::Piece_type::King || !cbn::move_is_legal(legal.get_legal_moves(move.from), move))
+            throw BadSanError;
+        return move;
+    }
+
+    cbn::Piece_type type = cbn::Piece_type::Pawn;
+    if (!san.empty() && std::isupper(static_cast<unsigned char>(san.front())))
+    {
+        const auto letter = cbn::PIECE_LETTERS.find(san.front());
+        if (letter == std::string_view::npos)
+            throw BadSanError;
+        type = static_cast<cbn::Piece_type>(letter);
+        san.remove_prefix(1);
+    }
+
+    // promotion piece, written with or without '='
+    if (type == cbn::Piece_type::Pawn && !san.empty() && std::isupper(static_cast<unsigned char>(san.back())))
+    {
+        if (san.back() != 'Q')
+            throw UnderpromotionError;
+        san.remove_suffix(1);
+        if (!san.empty() && san.back() == '=')
+            san.remove_suffix(1);
+    }
+
+    if (san.size() < 2)
+        throw BadSanError;
+
+    const cbn::ChessCoordinate target = cbn::square_from_name(std::string{san.substr(san.size() - 2)});
+    if (!target.is_valid())
+        throw BadSanError;
+    san.remove_suffix(2);
+
+    // what is left names the file and/or rank of the moving piece
+    int from_character = cbn::CHESSCOORDINATE_INVALID_VALUE;
+    int from_integer = cbn::CHESSCOORDINATE_INVALID_VALUE;
+    for (char c : san)
+    {
+        if ('a' <= c && c <= 'h')
+            from_character = c - cbn::ALPHABET_TO_INT;
+        else if ('1' <= c && c <= '8')
+            from_integer = '8' - c;
+        else if (c != 'x' && c != ':' && c != '-')
+            throw BadSanError;
+    }
+
+    // pawns not taking stay on their file
+    if (type == cbn::Piece_type::Pawn && from_character == cbn::CHESSCOORDINATE_INVALID_VALUE)
+        from_character = target.character;
+
+    cbn::ChessNotation move;
+    int candidates = 0;
+
+    for (int row_i = 0; row_i < cbn::CHESS_BOARD_SIZE; ++row_i)
+    {
+        if (from_integer != cbn::CHESSCOORDINATE_INVALID_VALUE && row_i != from_integer)
+            continue;
+
+        for (int piece_i = 0; piece_i < cbn::CHESS_BOARD_SIZE; ++piece_i)
+        {
+            if (from_character != cbn::CHESSCOORDINATE_INVALID_VALUE && piece_i != from_character)
+                continue;
+
+            const cbn::ChessCoordinate from{piece_i, row_i};
+            const cbn::Piece& piece = board[from];
+            if (piece.type != type || piece.color != us || from == target || !reaches(type, from, target))
+                continue;
+
+            const cbn::ChessNotation candidate{from, target};
+            if (cbn::move_is_legal(legal.get_legal_moves(from), candidate))
+            {
+                move = candidate;
+                ++candidates;
+            }
+        }
+    }
+
+    if (candidates != 1)
+        throw BadSanError;
+    return move;
+}
+
+cbn::ChessBoard pgn::start_position(const GameRecord& game)
+{
+    for (const auto& [name, value] : game.tags)
+        if (name == "FEN")
+            return cbn::ChessBoard{value};
+    return cbn::ChessBoard{};
+}
+
+template <typename Visit>
+void pgn::replay(const GameRecord& game, cbn::ChessBoard& board, Visit visit)
+{
+    lmn::Legalmoves legal{board};
+
+    for (const auto& san : game.moves)
+    {
+        const cbn::ChessNotation move = parse_san(board, legal, san);
+        visit(board, move);
+        board.move(legal.get_legal_moves(move.from), move);
+    }
+}
+
+bool pgn::is_result(std::string_view token)
+{
+    return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+void pgn::Reader::skip_space()
+{
+    while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos])))
+        ++pos;
+}
+
+void pgn::Reader::skip_comment(char end)
+// skip text up to and including end
+{
+    const std::size_t found = text.find(end, pos);
+    pos = (found == std::string_view::npos) ? text.size() : found + 1;
+}
+
+void pgn::Reader::skip_variation()
+// skip a variation with its nested variations and comments, pos is behind the opening '('
+{
+    int depth = 1;
+    while (pos < text.size() && depth > 0)
+    {
+        const char c = text[pos++];
+        if (c == '(')
+            ++depth;
+        else if (c == ')')
+            --depth;
+        else if (c == '{')
+            skip_comment('}');
+    }
+}
+
+std::string_view pgn::Reader::read_token()
+// return characters up to the next space or movetext delimiter
+{
+    const std::size_t start = pos;
+    while (pos < text.size() && !std::isspace(static_cast<unsigned char>(text[pos]))
+           && std::string_view{"{}();[]$"}.find(text[pos]) == std::string_view::npos)
+        ++pos;
+    return text.substr(start, pos - start);
+}
+
+std::string_view pgn::Reader::read_quoted()
+// return string value behind pos, escaped characters keep their backslash
+{
+    const std::size_t open = text.find('"', pos);
+    if (open == std::string_view::npos)
+    {
+        pos = text.size();
+        return {};
+    }
+
+    std::size_t close = open + 1;
+    while (close < text.size() && text[close] != '"')
+        close += (text[close] == '\\') ? 2 : 1;
+
+    pos = std::min(close + 1, text.size());
+    return text.substr(open + 1, std::min(close, text.size()) - open - 1);
+}
+
+bool pgn::Reader::next(GameRecord& game)
+{
+    std::size_t tag_count = 0;
+    std::size_t move_count = 0;
+    game.result = "*";
+
+    // tag pairs
+    skip_space();
+    while (pos < text.size() && (text[pos] == '[' || text[pos] == '%' || text[pos] == ';'))
+    {
+        if (text[pos] != '[')
+        {
+            skip_comment('\n');
+            skip_space();
+            continue;
+        }
+
+        ++pos;
+        skip_space();
+        const std::string_view name = read_token();
+        const std::string_view value = read_quoted();
+        skip_comment(']');
+        skip_space();
+
+        // strings of the previous game are reused
+        if (tag_count == game.tags.size())
+            game.tags.emplace_back();
+        game.tags[tag_count].first.assign(name);
+        game.tags[tag_count].second.assign(value);
+        ++tag_count;
+    }
+
+    // movetext up to the result or the tags of the next game
+    bool finished = false;
+    while (!finished)
+    {
+        skip_space();
+        if (pos >= text.size())
+            break;
+
+        switch (text[pos])
+        {
+            case '{':
+                skip_comment('}');
+                break;
+            case ';':
+                skip_comment('\n');
+                break;
+            case '(':
+                ++pos;
+                skip_variation();
+                break;
+            case '$':
+                ++pos;
+                read_token();
+                break;
+            case '[':
+                finished = true;
+                break;
+            case ')':
+            case ']':
+            case '}':
+                ++pos;
+                break;
+            default:
+            {
+                std::string_view token = read_token();
+
+                if (is_result(token))
+                {
+                    game.result.assign(token);
+                    finished = true;
+                    break;
+                }
+
+                // move number, possibly glued to the move: "12." "12..." "12.Nf3"
+                std::size_t digits = 0;
+                while (digits < token.size() && std::isdigit(static_cast<unsigned char>(token[digits])))
+                    ++digits;
+                if (digits > 0 && digits < token.size() && token[digits] == '.')
+                {
+                    token.remove_prefix(digits);
+                    while (!token.empty() && token.front() == '.')
+                        token.remove_prefix(1);
+                }
+                else if (digits > 0 && digits == token.size())
+                    token = {};
+
+                if (token.empty())
+                    break;
+
+                if (move_count == game.moves.size())
+                    game.moves.emplace_back();
+                game.moves[move_count++].assign(token);
+            }
+        }
+    }
+
+    game.tags.resize(tag_count);
+    game.moves.resize(move_count);
+
+    return tag_count > 0 || move_count > 0;
+}
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "chess_notation.hpp"
+
+/*
+One byte squares
+
+A Square is the index integer * 8 + character of a ChessCoordinate, the same index zobrist::square_index
+gives and the bit a square has in a 64 bit square mask. ChessCoordinate stays the type of parsing and printing,
+code asking how two squares lie to each other converts at its edge and looks the answer up in tables built at compile time:
+
+    BETWEEN[x][y]      squares strictly between x and y on a rank, file or diagonal, no squares if they share none
+    LINE[x][y]         whole rank, file or diagonal through x and y including both, no squares if they share none
+    DISTANCE[x][y]     king steps from x to y
+    DIRECTION[x][y]    index into DIRECTIONS of the step leading from x towards y, NO_DIRECTION if they share no line
+    RAY[d][x]          squares from x in direction d up to the edge of the board, x excluded
+    KNIGHT_STEPS[x]    squares a knight on x jumps to, KING_STEPS[x] the same for a king
+    PAWN_STEPS[u][x]   squares a pawn on x takes on, u = 0 for pawns moving towards integer 0, 1 for the others
+*/
+
+namespace chess_square
+{
+    using square_mask = std::uint64_t;  // one bit per square, bit s is Square{s}
+
+    constexpr int BOARD_SIZE = chess_notation::MAX_INDEX + 1;
+    constexpr int SQUARE_COUNT = BOARD_SIZE * BOARD_SIZE;
+    constexpr int NO_DIRECTION = -1;
+
+    struct Square
+    {
+        std::uint8_t index;
+
+        constexpr int character() const { return index % BOARD_SIZE; }
+        constexpr int integer() const { return index / BOARD_SIZE; }
+    };
+
+    static_assert(sizeof(Square) == 1 && std::is_trivially_copyable<Square>::value, "Square has to stay a plain byte");
+
+    constexpr bool operator==(Square x, Square y) { return x.index == y.index; }
+    constexpr bool operator!=(Square x, Square y) { return x.index != y.index; }
+    constexpr bool operator<(Square x, Square y) { return x.index < y.index; }
+
+    constexpr Square make_square(int character, int integer)
+    // Pre-Condition: both are in [0, BOARD_SIZE)
+    {
+        return Square{static_cast<std::uint8_t>(integer * BOARD_SIZE + character)};
+    }
+
+    inline Square to_square(const chess_notation::ChessCoordinate& location)
+    // Pre-Condition: location is valid
+    {
+        return make_square(location.character, location.integer);
+    }
+
+    inline chess_notation::ChessCoordinate to_coordinate(Square square)
+    {
+        return chess_notation::ChessCoordinate{square.character(), square.integer()};
+    }
+
+    constexpr square_mask bit(Square square)
+    {
+        return square_mask{1} << square.index;
+    }
+
+    // {offset_x, offset_y} of the 8 lines leaving a square, the first 4 are ranks and files, the last 4 diagonals
+    // direction d and d ^ 1 point opposite ways
+    constexpr std::array<std::pair<int,int>, 8> DIRECTIONS{{ {0, 1}, {0, -1}, {1, 0}, {-1, 0}, {1, 1}, {-1, -1}, {1, -1}, {-1, 1} }};
+
+    constexpr bool is_straight(int direction)
+    {
+        return 0 <= direction && direction < 4;
+    }
+
+    constexpr bool is_diagonal(int direction)
+    {
+        return 4 <= direction;
+    }
+
+    template <typename T>
+    using square_table = std::array<std::array<T, SQUARE_COUNT>, SQUARE_COUNT>;
+
+    constexpr int sign(int value)
+    {
+        return (value > 0) - (value < 0);
+    }
+
+    constexpr square_table<std::int8_t> generate_directions()
+    {
+        square_table<std::int8_t> table{};
+
+        for (int x = 0; x < SQUARE_COUNT; ++x)
+        {
+            for (int y = 0; y < SQUARE_COUNT; ++y)
+            {
+                const int dx = Square{static_cast<std::uint8_t>(y)}.character() - Square{static_cast<std::uint8_t>(x)}.character();
+                const int dy = Square{static_cast<std::uint8_t>(y)}.integer() - Square{static_cast<std::uint8_t>(x)}.integer();
+
+                table[x][y] = NO_DIRECTION;
+                if (x == y || (dx != 0 && dy != 0 && (dx > 0 ? dx : -dx) != (dy > 0 ? dy : -dy)))
+                    continue;
+
+                for (int direction = 0; direction < static_cast<int>(DIRECTIONS.size()); ++direction)
+                {
+                    if (DIRECTIONS[direction].first == sign(dx) && DIRECTIONS[direction].second == sign(dy))
+                        table[x][y] = static_cast<std::int8_t>(direction);
+                }
+            }
+        }
+        return table;
+    }
+
+    constexpr square_table<std::int8_t> DIRECTION = generate_directions();
+
+    constexpr square_table<std::uint8_t> generate_distances()
+    {
+        square_table<std::uint8_t> table{};
+
+        for (int x = 0; x < SQUARE_COUNT; ++x)
+        {
+            for (int y = 0; y < SQUARE_COUNT; ++y)
+            {
+                const int dx = Square{static_cast<std::uint8_t>(y)}.character() - Square{static_cast<std::uint8_t>(x)}.character();
+                const int dy = Square{static_cast<std::uint8_t>(y)}.integer() - Square{static_cast<std::uint8_t>(x)}.integer();
+                const int abs_dx = dx > 0 ? dx : -dx;
+                const int abs_dy = dy > 0 ? dy : -dy;
+                table[x][y] = static_cast<std::uint8_t>(abs_dx > abs_dy ? abs_dx : abs_dy);
+            }
+        }
+        return table;
+    }
+
+    constexpr square_table<std::uint8_t> DISTANCE = generate_distances();
+
+    constexpr square_mask walk(int from, int direction, int steps)
+    // return squares of the first steps steps from square from in direction, fewer at the edge of the board
+    {
+        square_mask squares = 0;
+        int character = Square{static_cast<std::uint8_t>(from)}.character();
+        int integer = Square{static_cast<std::uint8_t>(from)}.integer();
+
+        for (int step = 0; step < steps; ++step)
+        {
+            character += DIRECTIONS[direction].first;
+            integer += DIRECTIONS[direction].second;
+            if (character < 0 || character >= BOARD_SIZE || integer < 0 || integer >= BOARD_SIZE)
+                break;
+            squares |= bit(make_square(character, integer));
+        }
+        return squares;
+    }
+
+    constexpr square_table<square_mask> generate_between()
+    {
+        square_table<square_mask> table{};
+
+        for (int x = 0; x < SQUARE_COUNT; ++x)
+            for (int y = 0; y < SQUARE_COUNT; ++y)
+                if (DIRECTION[x][y] != NO_DIRECTION)
+                    table[x][y] = walk(x, DIRECTION[x][y], DISTANCE[x][y] - 1);
+        return table;
+    }
+
+    constexpr square_table<square_mask> BETWEEN = generate_between();
+
+    constexpr square_table<square_mask> generate_lines()
+    {
+        square_table<square_mask> table{};
+
+        for (int x = 0; x < SQUARE_COUNT; ++x)
+        {
+            for (int y = 0; y < SQUARE_COUNT; ++y)
+            {
+                const int direction = DIRECTION[x][y];
+                if (direction == NO_DIRECTION)
+                    continue;
+
+                table[x][y] = bit(Square{static_cast<std::uint8_t>(x)}) | walk(x, direction, BOARD_SIZE) | walk(x, direction ^ 1, BOARD_SIZE);
+            }
+        }
+        return table;
+    }
+
+    constexpr square_table<square_mask> LINE = generate_lines();
+
+    template <typename T>
+    using direction_table = std::array<std::array<T, SQUARE_COUNT>, DIRECTIONS.size()>;
+
+    constexpr direction_table<square_mask> generate_rays()
+    {
+        direction_table<square_mask> table{};
+
+        for (int direction = 0; direction < static_cast<int>(DIRECTIONS.size()); ++direction)
+            for (int x = 0; x < SQUARE_COUNT; ++x)
+                table[direction][x] = walk(x, direction, BOARD_SIZE);
+        return table;
+    }
+
+    constexpr direction_table<square_mask> RAY = generate_rays();
+
+    constexpr bool ascending(int direction)
+    // return true if the square index grows along direction --> the nearest square of a ray is its lowest bit
+    {
+        return DIRECTIONS[direction].second * BOARD_SIZE + DIRECTIONS[direction].first > 0;
+    }
+
+    template <std::size_t N>
+    constexpr std::array<square_mask, SQUARE_COUNT> generate_steps(const std::array<std::pair<int,int>, N>& offsets)
+    {
+        std::array<square_mask, SQUARE_COUNT> table{};
+
+        for (int x = 0; x < SQUARE_COUNT; ++x)
+        {
+            for (const auto& offset : offsets)
+            {
+                const int character = Square{static_cast<std::uint8_t>(x)}.character() + offset.first;
+                const int integer = Square{static_cast<std::uint8_t>(x)}.integer() + offset.second;
+                if (0 <= character && character < BOARD_SIZE && 0 <= integer && integer < BOARD_SIZE)
+                    table[x] |= bit(make_square(character, integer));
+            }
+        }
+        return table;
+    }
+
+    constexpr std::array<std::pair<int,int>, 8> KNIGHT_OFFSETS{{ {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2} }};
+    constexpr std::array<std::pair<int,int>, 2> PAWN_DOWN_OFFSETS{{ {-1, -1}, {1, -1} }};
+    constexpr std::array<std::pair<int,int>, 2> PAWN_UP_OFFSETS{{ {-1, 1}, {1, 1} }};
+
+    constexpr std::array<square_mask, SQUARE_COUNT> KNIGHT_STEPS = generate_steps(KNIGHT_OFFSETS);
+    constexpr std::array<square_mask, SQUARE_COUNT> KING_STEPS = generate_steps(DIRECTIONS);
+    constexpr std::array<std::array<square_mask, SQUARE_COUNT>, 2> PAWN_STEPS{ generate_steps(PAWN_DOWN_OFFSETS), generate_steps(PAWN_UP_OFFSETS) };
+
+    inline square_mask between(Square x, Square y) { return BETWEEN[x.index][y.index]; }
+    inline square_mask line(Square x, Square y) { return LINE[x.index][y.index]; }
+    inline int distance(Square x, Square y) { return DISTANCE[x.index][y.index]; }
+    inline int direction(Square x, Square y) { return DIRECTION[x.index][y.index]; }
+}
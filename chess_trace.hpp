@@ -0,0 +1,336 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chess_notation.hpp"
+#include "chess_square.hpp"
+#include "Exception.hpp"
+
+/*
+Search tree trace
+
+Compiled in with -DCHESS_TRACE, otherwise ENABLED is false and the search never touches a Session.
+A Session records one Record per searched node and per completed iteration. Every search thread
+writes into its own ring that only it pushes to and only the writer thread of the session pops from,
+neither side takes a lock, a full ring drops records and counts them. The writer thread empties all
+rings into the file every FLUSH_INTERVAL and once more when the session ends:
+
+    FileHeader | (BlockHeader | Record[count])...
+
+Blocks of different threads are interleaved, the records of one thread stay in order
+Numbers are stored in the byte order of the machine that wrote the file, trace_report reads it
+*/
+
+namespace trace
+{
+#ifdef CHESS_TRACE
+    constexpr bool ENABLED = true;
+#else
+    constexpr bool ENABLED = false;
+#endif
+
+    const char MAGIC[4] = {'C', 'T', 'R', 'C'};
+    const std::uint32_t VERSION = 1;
+
+    const std::size_t RING_SIZE = std::size_t{1} << 16;    // records a thread can be ahead of the writer
+    const auto FLUSH_INTERVAL = std::chrono::milliseconds(5);
+    const std::uint8_t NO_SQUARE = 0xFF;
+    const std::uint8_t NO_CUTOFF = 0xFF;
+
+    const Exception TraceWriteError{"TraceWriteError: Trace File Can Not Be Written"};
+    const Exception BadTraceError{"BadTraceError: File Is Not A Search Trace Of This Version"};
+    const Exception TraceDisabledError{"TraceDisabledError: Built Without CHESS_TRACE"};
+
+    enum class Kind : std::uint8_t { Node, Iteration };
+
+    // Pv --> score inside the window, Cut --> failed high, All --> failed low
+    enum class NodeType : std::uint8_t { Pv, Cut, All };
+
+    struct Record
+    {
+        std::uint64_t stamp;    // Node: node count of the search, Iteration: start in microseconds since the session began
+        float alpha;
+        float beta;
+        float score;            // result of the node or of the iteration
+        std::uint32_t span;     // Iteration: duration in microseconds
+        Kind kind;
+        std::uint8_t ply;
+        std::uint8_t depth;
+        NodeType type;
+        std::uint8_t from;      // chess_square index of the best move, the cutoff move of a cut node
+        std::uint8_t to;
+        std::uint8_t cutoff;    // index of the move that failed high, NO_CUTOFF if none did
+        std::uint8_t reserved;
+    };
+
+    static_assert(sizeof(Record) == 32, "Record is part of the file format");
+
+    struct FileHeader
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t record_size;
+        std::uint32_t reserved;
+    };
+
+    struct BlockHeader
+    {
+        std::uint32_t thread;   // threads are numbered in the order they first recorded
+        std::uint32_t count;
+        std::uint64_t dropped;  // records the thread dropped up to this block
+    };
+
+    struct NodeResult
+    // what a node tells its trace record besides window and score
+    {
+        chess_notation::ChessNotation move;
+        int cutoff = NO_CUTOFF;
+    };
+
+    struct ThreadTrace
+    {
+        std::uint32_t thread = 0;
+        std::uint64_t dropped = 0;
+        std::vector<Record> records;
+    };
+
+    class Session{
+    public:
+        // start recording into path, throws TraceWriteError
+        explicit Session(const std::string& path);
+
+        // write what the rings still hold and close the file
+        ~Session();
+
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+
+        void node(std::uint64_t stamp, int ply, int depth, double alpha, double beta, double score, const NodeResult& result);
+
+        void iteration(std::chrono::steady_clock::time_point start, int depth, double score);
+
+    private:
+        struct Ring
+        {
+            explicit Ring(std::uint32_t t)
+                :thread(t), records(new Record[RING_SIZE]) {   }
+
+            const std::uint32_t thread;
+            std::unique_ptr<Record[]> records;
+            alignas(64) std::atomic<std::uint64_t> head{0};    // next record the thread writes
+            alignas(64) std::atomic<std::uint64_t> tail{0};    // next record the writer reads
+            std::atomic<std::uint64_t> dropped{0};
+        };
+
+        // return ring of the calling thread, registered on its first record
+        Ring& ring();
+
+        void push(const Record& record);
+
+        void flush();
+
+        void write_loop();
+
+        const std::uint64_t id;    // tells the thread local ring caches of different sessions apart
+        const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        std::ofstream out;
+
+        std::mutex rings_mutex;    // guards the list, not the rings
+        std::vector<std::unique_ptr<Ring>> rings;
+
+        std::atomic<bool> done{false};
+        std::thread writer;
+    };
+
+    // return records of every thread in file order, throws BadTraceError
+    std::vector<ThreadTrace> read_trace(const std::string& path);
+
+    // return chess_square index of location, NO_SQUARE if it is not on the board
+    std::uint8_t square_index(const chess_notation::ChessCoordinate& location);
+
+    // return a number no earlier session got
+    std::uint64_t next_session_id();
+}
+
+/**************************************************************************************Function definition*******************************************************************/
+
+std::uint8_t trace::square_index(const chess_notation::ChessCoordinate& location)
+{
+    return location.is_valid() ? chess_square::to_square(location).index : NO_SQUARE;
+}
+
+std::uint64_t trace::next_session_id()
+{
+    static std::atomic<std::uint64_t> sessions{0};
+    return ++sessions;
+}
+
+trace::Session::Session(const std::string& path)
+    :id(next_session_id()), out(path, std::ios::binary | std::ios::trunc)
+{
+    const FileHeader header{{MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3]}, VERSION, static_cast<std::uint32_t>(sizeof(Record)), 0};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!out)
+        throw TraceWriteError;
+
+    writer = std::thread(&Session::write_loop, this);
+}
+
+trace::Session::~Session()
+{
+    done = true;
+    writer.join();
+}
+
+trace::Session::Ring& trace::Session::ring()
+{
+    thread_local std::uint64_t owner = 0;
+    thread_local Ring* cached = nullptr;
+
+    if (owner != id)
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        rings.push_back(std::make_unique<Ring>(static_cast<std::uint32_t>(rings.size())));
+        cached = rings.back().get();
+        owner = id;
+    }
+    return *cached;
+}
+
+void trace::Session::push(const Record& record)
+// single producer side of the ring, a full ring loses the record instead of waiting for the writer
+{
+    Ring& r = ring();
+    const std::uint64_t head = r.head.load(std::memory_order_relaxed);
+
+    if (head - r.tail.load(std::memory_order_acquire) == RING_SIZE)
+    {
+        r.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    r.records[head % RING_SIZE] = record;
+    r.head.store(head + 1, std::memory_order_release);
+}
+
+void trace::Session::node(std::uint64_t stamp, int ply, int depth, double alpha, double beta, double score, const NodeResult& result)
+{
+    NodeType type = NodeType::Pv;
+    if (score >= beta)
+        type = NodeType::Cut;
+    else if (score <= alpha)
+        type = NodeType::All;
+
+    Record record{};
+    record.stamp = stamp;
+    record.alpha = static_cast<float>(alpha);
+    record.beta = static_cast<float>(beta);
+    record.score = static_cast<float>(score);
+    record.kind = Kind::Node;
+    record.ply = static_cast<std::uint8_t>(ply);
+    record.depth = static_cast<std::uint8_t>(std::max(depth, 0));
+    record.type = type;
+    record.from = square_index(result.move.from);
+    record.to = square_index(result.move.to);
+    record.cutoff = static_cast<std::uint8_t>(std::min(result.cutoff, int{NO_CUTOFF}));
+    push(record);
+}
+
+void trace::Session::iteration(std::chrono::steady_clock::time_point start, int depth, double score)
+{
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+
+    Record record{};
+    record.stamp = static_cast<std::uint64_t>(duration_cast<microseconds>(start - begin).count());
+    record.span = static_cast<std::uint32_t>(duration_cast<microseconds>(std::chrono::steady_clock::now() - start).count());
+    record.score = static_cast<float>(score);
+    record.kind = Kind::Iteration;
+    record.depth = static_cast<std::uint8_t>(depth);
+    record.from = record.to = NO_SQUARE;
+    record.cutoff = NO_CUTOFF;
+    push(record);
+}
+
+void trace::Session::flush()
+// consumer side of every ring, writes the records pushed so far as one block per ring
+{
+    std::lock_guard<std::mutex> lock(rings_mutex);
+
+    for (auto& r : rings)
+    {
+        const std::uint64_t tail = r->tail.load(std::memory_order_relaxed);
+        const std::uint64_t head = r->head.load(std::memory_order_acquire);
+        if (head == tail)
+            continue;
+
+        const BlockHeader block{r->thread, static_cast<std::uint32_t>(head - tail), r->dropped.load(std::memory_order_relaxed)};
+        out.write(reinterpret_cast<const char*>(&block), sizeof(block));
+
+        // the pushed records may wrap around the end of the ring
+        const std::size_t first = tail % RING_SIZE;
+        const std::size_t count = head - tail;
+        const std::size_t until_end = std::min(count, RING_SIZE - first);
+        out.write(reinterpret_cast<const char*>(&r->records[first]), until_end * sizeof(Record));
+        out.write(reinterpret_cast<const char*>(&r->records[0]), (count - until_end) * sizeof(Record));
+
+        r->tail.store(head, std::memory_order_release);
+    }
+}
+
+void trace::Session::write_loop()
+{
+    while (!done.load())
+    {
+        std::this_thread::sleep_for(FLUSH_INTERVAL);
+        flush();
+    }
+    flush();
+    out.flush();
+}
+
+std::vector<trace::ThreadTrace> trace::read_trace(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+
+    FileHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.record_size != sizeof(Record))
+        throw BadTraceError;
+
+    std::vector<ThreadTrace> threads;
+    BlockHeader block;
+    while (in.read(reinterpret_cast<char*>(&block), sizeof(block)))
+    {
+        // a writer never has more records pending than one ring holds, threads appear in order
+        if (block.count > RING_SIZE || block.thread > threads.size())
+            throw BadTraceError;
+
+        if (block.thread == threads.size())
+        {
+            threads.emplace_back();
+            threads.back().thread = block.thread;
+        }
+
+        ThreadTrace& thread = threads[block.thread];
+        const std::size_t size = thread.records.size();
+        thread.records.resize(size + block.count);
+        thread.dropped = std::max(thread.dropped, block.dropped);
+
+        if (!in.read(reinterpret_cast<char*>(thread.records.data() + size), block.count * sizeof(Record)))
+            throw BadTraceError;
+    }
+
+    return threads;
+}
@@ -0,0 +1,513 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "chess_board.hpp"
+#include "chess_bot.hpp"
+#include "Exception.hpp"
+#include "MappedFile.hpp"
+
+/*
+Texel tuning of the piece square tables
+
+The piece part of board_score is linear in one weight per (color, piece, square):
+a white piece on a square adds piece_value * multiplier_table, a black one subtracts it.
+Everything else of the evaluation (pawn structure, king shelter) is computed once per position and kept as fixed
+
+A PositionBatch stores positions as structure of arrays:
+
+    features   FEATURES_PER_POSITION feature indices per position, unused slots hold PADDING_FEATURE
+    fixed      evaluation the tuned weights do not change
+    results    1 white won, 0.5 draw, 0 black won
+
+so evaluating a batch is one fixed length gather and sum per position over a flat weight vector,
+split into contiguous slices for all threads. The tuner minimizes the mean squared error between
+results and sigmoid(K * evaluation) and writes the tables and piece values back as chess_bot_tables.hpp
+*/
+
+namespace tuning
+{
+    const int SQUARES = chess_constants::CHESS_BOARD_SIZE * chess_constants::CHESS_BOARD_SIZE;
+    const int PIECE_TYPES = 6;                  // Pawn up to King of cbn::Piece_type
+    const int FEATURES_PER_POSITION = 32;       // pieces on a legal board
+    const std::uint16_t PADDING_FEATURE = 2 * PIECE_TYPES * SQUARES;   // has weight 0
+    const int FEATURE_COUNT = PADDING_FEATURE + 1;
+
+    const double DEFAULT_RATE = 0.002;      // Adam step size
+    const double ADAM_BETA1 = 0.9;
+    const double ADAM_BETA2 = 0.999;
+    const double ADAM_EPSILON = 1e-8;
+
+    const double MIN_SCALING = 0.1;         // range of K searched by best_scaling
+    const double MAX_SCALING = 4;
+    const double SCALING_STEP = 0.1;        // first pass, the second one is ten times finer
+    const double WRITTEN_DIGITS = 3;        // decimals of numbers in the generated header
+
+    const Exception TooManyPiecesError{"TooManyPiecesError: Position Has More Than 32 Pieces"};
+    const Exception TablesWriteError{"TablesWriteError: Generated Header Can Not Be Written"};
+
+    struct Parameters
+    {
+        std::array<std::array<double, SQUARES>, PIECE_TYPES> tables{};     // multiplier_table per piece, square = integer * 8 + character
+        std::array<double, PIECE_TYPES> values{};                           // piece_value per piece
+    };
+
+    struct PositionBatch
+    {
+        std::vector<std::uint16_t> features;
+        std::vector<float> fixed;
+        std::vector<float> results;
+
+        std::size_t size() const { return results.size(); }
+
+        // append board with its game result, fixed is board_score minus the part the feature weights give
+        void add(const cbn::ChessBoard& board, float result, const std::vector<float>& weights);
+
+        void append(const PositionBatch& other);
+    };
+
+    // return the tables and values compiled into the engine
+    Parameters current_parameters();
+
+    // return index of a piece on square, color * 384 + type * 64 + square
+    std::uint16_t feature_index(const cbn::Piece& piece, const cbn::ChessCoordinate& square);
+
+    // return weight of every feature: +- value * table of the piece, 0 for the padding feature
+    std::vector<float> feature_weights(const Parameters& parameters);
+
+    // return game result of a labelled EPD line, c9 "1-0" or [1.0] style, false if the line has none
+    bool parse_result(std::string_view line, float& result);
+
+    // return batch of every labelled position of an EPD file, lines without result or with a broken position are counted in skipped
+    PositionBatch load_positions(const std::string& path, const Parameters& parameters, unsigned threads, std::size_t& skipped);
+
+    // run work(begin, end, slice) for threads contiguous slices of [0, size)
+    template <typename Work>
+    void parallel_slices(std::size_t size, unsigned threads, Work work);
+
+    // write evaluation of every position of batch to scores, white's point of view in pawns
+    void evaluate_batch(const PositionBatch& batch, const std::vector<float>& weights, std::vector<float>& scores, unsigned threads);
+
+    double sigmoid(double score, double scaling);
+
+    // return mean squared error of sigmoid(scaling * evaluation) against the results
+    double error(const PositionBatch& batch, const std::vector<float>& weights, double scaling, unsigned threads);
+
+    // return K with the smallest error for weights
+    double best_scaling(const PositionBatch& batch, const std::vector<float>& weights, unsigned threads);
+
+    // return derivative of error by every feature weight
+    std::vector<double> feature_gradient(const PositionBatch& batch, const std::vector<float>& weights, double scaling, unsigned threads);
+
+    // return derivative of error by the tables and values, the king value stays 0
+    Parameters parameter_gradient(const Parameters& parameters, const std::vector<double>& gradient);
+
+    class Optimizer{
+    public:
+        explicit Optimizer(double learning_rate = DEFAULT_RATE) :rate(learning_rate) {}
+
+        // move parameters one Adam step against gradient
+        void step(Parameters& parameters, const Parameters& gradient);
+
+    private:
+        void update(double& parameter, double gradient, double& first, double& second) const;
+
+        double rate;
+        int steps = 0;
+        Parameters first_moment;
+        Parameters second_moment;
+    };
+
+    // write parameters as chess_bot_tables.hpp to path, comment is put in its first lines
+    void write_header(const Parameters& parameters, const std::string& path, const std::string& comment);
+}
+
+/**************************************************************************************Function definition*******************************************************************/
+
+tuning::Parameters tuning::current_parameters()
+{
+    Parameters parameters;
+
+    for (int type = 0; type < PIECE_TYPES; ++type)
+    {
+        const cbn::Piece_type piece_type = static_cast<cbn::Piece_type>(type);
+        for (int square = 0; square < SQUARES; ++square)
+        {
+            const cbn::ChessCoordinate location{square % cbn::CHESS_BOARD_SIZE, square / cbn::CHESS_BOARD_SIZE};
+            parameters.tables[type][square] = cbot::multiplier_table(piece_type, location);
+        }
+        parameters.values[type] = cbot_constants::piece_value.at(piece_type);
+    }
+    return parameters;
+}
+
+std::uint16_t tuning::feature_index(const cbn::Piece& piece, const cbn::ChessCoordinate& square)
+{
+    const int color = (piece.color == cbn::Piece_color::White) ? 0 : 1;
+    return static_cast<std::uint16_t>((color * PIECE_TYPES + static_cast<int>(piece.type)) * SQUARES
+                                      + square.integer * cbn::CHESS_BOARD_SIZE + square.character);
+}
+
+std::vector<float> tuning::feature_weights(const Parameters& parameters)
+{
+    std::vector<float> weights(FEATURE_COUNT, 0);
+
+    for (int type = 0; type < PIECE_TYPES; ++type)
+    {
+        for (int square = 0; square < SQUARES; ++square)
+        {
+            const double weight = parameters.values[type] * parameters.tables[type][square];
+            weights[type * SQUARES + square] = static_cast<float>(weight);
+            weights[(PIECE_TYPES + type) * SQUARES + square] = static_cast<float>(-weight);
+        }
+    }
+    return weights;
+}
+
+void tuning::PositionBatch::add(const cbn::ChessBoard& board, float result, const std::vector<float>& weights)
+{
+    const std::size_t first = features.size();
+    features.resize(first + FEATURES_PER_POSITION, PADDING_FEATURE);
+
+    double linear = 0;
+    int count = 0;
+    for (int row = 0; row < cbn::CHESS_BOARD_SIZE; ++row)
+    {
+        for (int column = 0; column < cbn::CHESS_BOARD_SIZE; ++column)
+        {
+            const cbn::ChessCoordinate square{column, row};
+            const cbn::Piece& piece = board[square];
+            if (piece.type == cbn::Piece_type::Empty)
+                continue;
+            if (count == FEATURES_PER_POSITION)
+                throw TooManyPiecesError;
+
+            const std::uint16_t feature = feature_index(piece, square);
+            features[first + count++] = feature;
+            linear += weights[feature];
+        }
+    }
+
+    const cbot::PawnEntry pawns = cbot::evaluate_pawns(board);
+    const double evaluation = cbot::board_score(board, cbn::Piece_color::White, pawns) - cbot::board_score(board, cbn::Piece_color::Black, pawns);
+    fixed.push_back(static_cast<float>(evaluation - linear));
+    results.push_back(result);
+}
+
+void tuning::PositionBatch::append(const PositionBatch& other)
+{
+    features.insert(features.end(), other.features.begin(), other.features.end());
+    fixed.insert(fixed.end(), other.fixed.begin(), other.fixed.end());
+    results.insert(results.end(), other.results.begin(), other.results.end());
+}
+
+bool tuning::parse_result(std::string_view line, float& result)
+// the result is the last one of the line, so an id or comment before it can not be mistaken for it
+{
+    const std::pair<std::string_view, float> labels[] = {
+        {"\"1-0\"", 1}, {"\"0-1\"", 0}, {"\"1/2-1/2\"", 0.5f},
+        {"[1.0]", 1}, {"[0.0]", 0}, {"[0.5]", 0.5f},
+    };
+
+    std::size_t best = std::string_view::npos;
+    for (const auto& [label, value] : labels)
+    {
+        const std::size_t found = line.rfind(label);
+        if (found != std::string_view::npos && (best == std::string_view::npos || found > best))
+        {
+            best = found;
+            result = value;
+        }
+    }
+    return best != std::string_view::npos;
+}
+
+template <typename Work>
+void tuning::parallel_slices(std::size_t size, unsigned threads, Work work)
+{
+    threads = std::max(1u, threads);
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+
+    for (unsigned i = 0; i < threads; ++i)
+        workers.emplace_back(work, size * i / threads, size * (i + 1) / threads, i);
+    for (auto& worker : workers)
+        worker.join();
+}
+
+tuning::PositionBatch tuning::load_positions(const std::string& path, const Parameters& parameters, unsigned threads, std::size_t& skipped)
+// every thread parses the lines of its own slice of the file
+{
+    io::MappedFile file{path};
+    const std::string_view text = file.data();
+    const std::vector<float> weights = feature_weights(parameters);
+    threads = std::max(1u, threads);
+
+    std::vector<std::size_t> bounds{0};
+    for (unsigned i = 1; i < threads; ++i)
+    {
+        const std::size_t found = text.find('\n', std::max(bounds.back(), text.size() / threads * i));
+        bounds.push_back((found == std::string_view::npos) ? text.size() : found + 1);
+    }
+    bounds.push_back(text.size());
+
+    std::vector<PositionBatch> batches(threads);
+    std::vector<std::size_t> skipped_lines(threads, 0);
+
+    auto load_slice = [&](unsigned slice){
+        std::size_t offset = bounds[slice];
+        while (offset < bounds[slice + 1])
+        {
+            const std::size_t end = std::min(text.find('\n', offset), bounds[slice + 1]);
+            const std::string_view line = text.substr(offset, end - offset);
+            offset = end + 1;
+
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            float result = 0;
+            if (!parse_result(line, result))
+            {
+                ++skipped_lines[slice];
+                continue;
+            }
+            try {
+                batches[slice].add(cbn::ChessBoard{std::string{line}}, result, weights);
+            }
+            catch (Exception&)
+            {
+                ++skipped_lines[slice];
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; ++i)
+        workers.emplace_back(load_slice, i);
+    for (auto& worker : workers)
+        worker.join();
+
+    PositionBatch batch;
+    skipped = 0;
+    for (unsigned i = 0; i < threads; ++i)
+    {
+        batch.append(batches[i]);
+        skipped += skipped_lines[i];
+    }
+    return batch;
+}
+
+void tuning::evaluate_batch(const PositionBatch& batch, const std::vector<float>& weights, std::vector<float>& scores, unsigned threads)
+{
+    scores.resize(batch.size());
+
+    parallel_slices(batch.size(), threads, [&](std::size_t begin, std::size_t end, unsigned){
+        const float* weight = weights.data();
+        for (std::size_t position = begin; position < end; ++position)
+        {
+            // fixed trip count, the compiler unrolls it and gathers with vector instructions where the target has them
+            const std::uint16_t* features = batch.features.data() + position * FEATURES_PER_POSITION;
+            float sum = batch.fixed[position];
+            for (int slot = 0; slot < FEATURES_PER_POSITION; ++slot)
+                sum += weight[features[slot]];
+            scores[position] = sum;
+        }
+    });
+}
+
+double tuning::sigmoid(double score, double scaling)
+{
+    return 1 / (1 + std::exp(-scaling * score));
+}
+
+double tuning::error(const PositionBatch& batch, const std::vector<float>& weights, double scaling, unsigned threads)
+{
+    std::vector<float> scores;
+    evaluate_batch(batch, weights, scores, threads);
+
+    std::vector<double> sums(std::max(1u, threads), 0);
+    parallel_slices(batch.size(), threads, [&](std::size_t begin, std::size_t end, unsigned slice){
+        double sum = 0;
+        for (std::size_t position = begin; position < end; ++position)
+        {
+            const double difference = batch.results[position] - sigmoid(scores[position], scaling);
+            sum += difference * difference;
+        }
+        sums[slice] = sum;
+    });
+
+    double total = 0;
+    for (double sum : sums)
+        total += sum;
+    return total / std::max<std::size_t>(1, batch.size());
+}
+
+double tuning::best_scaling(const PositionBatch& batch, const std::vector<float>& weights, unsigned threads)
+// coarse scan over the whole range, then a finer one around its best K
+{
+    double best = MIN_SCALING;
+    double best_error = error(batch, weights, best, threads);
+
+    double low = MIN_SCALING, high = MAX_SCALING, step = SCALING_STEP;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (double scaling = low; scaling <= high + step / 2; scaling += step)
+        {
+            const double current = error(batch, weights, scaling, threads);
+            if (current < best_error)
+            {
+                best = scaling;
+                best_error = current;
+            }
+        }
+        low = std::max(MIN_SCALING, best - step);
+        high = best + step;
+        step /= 10;
+    }
+    return best;
+}
+
+std::vector<double> tuning::feature_gradient(const PositionBatch& batch, const std::vector<float>& weights, double scaling, unsigned threads)
+// d error / d weight = mean of -2 (result - s) s (1 - s) K over the positions the feature is in
+{
+    std::vector<float> scores;
+    evaluate_batch(batch, weights, scores, threads);
+
+    threads = std::max(1u, threads);
+    std::vector<std::vector<double>> partial(threads, std::vector<double>(FEATURE_COUNT, 0));
+
+    parallel_slices(batch.size(), threads, [&](std::size_t begin, std::size_t end, unsigned slice){
+        double* gradient = partial[slice].data();
+        for (std::size_t position = begin; position < end; ++position)
+        {
+            const double s = sigmoid(scores[position], scaling);
+            const double delta = -2 * (batch.results[position] - s) * s * (1 - s) * scaling;
+
+            const std::uint16_t* features = batch.features.data() + position * FEATURES_PER_POSITION;
+            for (int slot = 0; slot < FEATURES_PER_POSITION; ++slot)
+                gradient[features[slot]] += delta;
+        }
+    });
+
+    std::vector<double> gradient(FEATURE_COUNT, 0);
+    const double positions = static_cast<double>(std::max<std::size_t>(1, batch.size()));
+    for (const auto& sums : partial)
+        for (int feature = 0; feature < FEATURE_COUNT; ++feature)
+            gradient[feature] += sums[feature] / positions;
+    return gradient;
+}
+
+tuning::Parameters tuning::parameter_gradient(const Parameters& parameters, const std::vector<double>& gradient)
+// weight of white is value * table, of black - value * table
+{
+    Parameters result;
+
+    for (int type = 0; type < PIECE_TYPES; ++type)
+    {
+        for (int square = 0; square < SQUARES; ++square)
+        {
+            const double by_weight = gradient[type * SQUARES + square] - gradient[(PIECE_TYPES + type) * SQUARES + square];
+            result.tables[type][square] = by_weight * parameters.values[type];
+            result.values[type] += by_weight * parameters.tables[type][square];
+        }
+    }
+    result.values[static_cast<int>(cbn::Piece_type::King)] = 0;
+    return result;
+}
+
+void tuning::Optimizer::step(Parameters& parameters, const Parameters& gradient)
+{
+    ++steps;
+    for (int type = 0; type < PIECE_TYPES; ++type)
+    {
+        for (int square = 0; square < SQUARES; ++square)
+            update(parameters.tables[type][square], gradient.tables[type][square], first_moment.tables[type][square], second_moment.tables[type][square]);
+        update(parameters.values[type], gradient.values[type], first_moment.values[type], second_moment.values[type]);
+    }
+}
+
+void tuning::Optimizer::update(double& parameter, double gradient, double& first, double& second) const
+{
+    first = ADAM_BETA1 * first + (1 - ADAM_BETA1) * gradient;
+    second = ADAM_BETA2 * second + (1 - ADAM_BETA2) * gradient * gradient;
+
+    const double corrected_first = first / (1 - std::pow(ADAM_BETA1, steps));
+    const double corrected_second = second / (1 - std::pow(ADAM_BETA2, steps));
+    parameter -= rate * corrected_first / (std::sqrt(corrected_second) + ADAM_EPSILON);
+}
+
+void tuning::write_header(const Parameters& parameters, const std::string& path, const std::string& comment)
+// written to a temporary file first, so a failed write leaves the old header in place
+{
+    const char* table_names[PIECE_TYPES] = {"pawn", "rook", "knight", "bishop", "queen", "king"};
+    const char* type_names[PIECE_TYPES] = {"Pawn", "Rook", "Knight", "Bishop", "Queen", "King"};
+    const cbn::Piece_type written_order[PIECE_TYPES] = {
+        cbn::Piece_type::Pawn, cbn::Piece_type::Knight, cbn::Piece_type::Bishop,
+        cbn::Piece_type::Rook, cbn::Piece_type::Queen, cbn::Piece_type::King,
+    };
+
+    // rounded to WRITTEN_DIGITS decimals without trailing zeros, at least one decimal is kept
+    auto number = [](double value){
+        const double scale = std::pow(10, WRITTEN_DIGITS);
+        value = std::round(value * scale) / scale;
+        if (value == 0)
+            value = 0;  // no -0.0
+
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(static_cast<int>(WRITTEN_DIGITS)) << value;
+        std::string text = os.str();
+        while (text.back() == '0' && text[text.size() - 2] != '.')
+            text.pop_back();
+        return text;
+    };
+
+    std::ostringstream os;
+    os << "#pragma once\n\n";
+    std::istringstream lines{comment};
+    for (std::string line; std::getline(lines, line);)
+        os << "// " << line << "\n";
+    os << "\n#include <array>\n#include <map>\n\n#include \"chess_board.hpp\"\n\nnamespace cbot_constants\n{\n";
+
+    for (cbn::Piece_type type : written_order)
+    {
+        const int index = static_cast<int>(type);
+        os << "    const std::array<std::array<double, 8>, 8> multiplier_table_" << table_names[index] << "\n    {{\n";
+        for (int row = 0; row < cbn::CHESS_BOARD_SIZE; ++row)
+        {
+            os << "        {";
+            for (int column = 0; column < cbn::CHESS_BOARD_SIZE; ++column)
+                os << (column ? ", " : " ") << number(parameters.tables[index][row * cbn::CHESS_BOARD_SIZE + column]);
+            os << " }" << (row + 1 < cbn::CHESS_BOARD_SIZE ? "," : "") << "\n";
+        }
+        os << "    }};\n\n";
+    }
+
+    os << "    const std::map<cbn::Piece_type, double> piece_value\n    {\n";
+    for (cbn::Piece_type type : written_order)
+    {
+        const int index = static_cast<int>(type);
+        os << "        {cbn::Piece_type::" << type_names[index] << ", " << number(parameters.values[index]) << "},\n";
+    }
+    os << "    };\n}\n";
+
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+        file << os.str();
+        if (!file.flush())
+            throw TablesWriteError;
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+        throw TablesWriteError;
+}
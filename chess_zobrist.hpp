@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "chess_notation.hpp"
+#include "chess_board_constants.hpp"
+
+/*
+Zobrist hashing
+
+Every (piece, square) pair gets a fixed pseudo random 64 bit key.
+The key of a set of pieces is the xor of the keys of its members,
+so moving a piece updates the key with two xor operations instead of rehashing the board
+Castling rights and the file of a pawn that can be taken en passant have keys of their own,
+positions differing only in them get different keys
+*/
+
+namespace zobrist
+{
+    using key_type = std::uint64_t;
+
+    const int PIECE_KINDS = 12; // 6 piece types for each of the 2 colors
+    const int SQUARE_COUNT = chess_constants::CHESS_BOARD_SIZE * chess_constants::CHESS_BOARD_SIZE;
+
+    const int CASTLING_KEY_COUNT = 4;   // [color][left, right rook]
+
+    const key_type SEED = 0x9E3779B97F4A7C15ULL;   // fixed so keys are the same in every run
+    const key_type CASTLING_SEED = 0xD1B54A32D192ED03ULL;
+    const key_type PASSANT_SEED = 0x8CB92BA72F3D8DD7ULL;
+
+    using key_table = std::array<std::array<key_type, SQUARE_COUNT>, PIECE_KINDS>;
+    using castling_table = std::array<key_type, CASTLING_KEY_COUNT>;
+    using passant_table = std::array<key_type, chess_constants::CHESS_BOARD_SIZE>;
+
+    key_type next_random(key_type& state)
+    // splitmix64 generator --> good enough distribution for hash keys
+    {
+        key_type z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    key_table generate_piece_keys()
+    {
+        key_table keys{};
+        key_type state = SEED;
+
+        for (auto& piece_keys : keys)
+            for (auto& key : piece_keys)
+                key = next_random(state);
+
+        return keys;
+    }
+
+    template <typename Table>
+    Table generate_keys(key_type seed)
+    {
+        Table keys{};
+        for (auto& key : keys)
+            key = next_random(seed);
+        return keys;
+    }
+
+    const key_table PIECE_KEYS = generate_piece_keys();
+    const castling_table CASTLING_KEYS = generate_keys<castling_table>(CASTLING_SEED);
+    const passant_table PASSANT_KEYS = generate_keys<passant_table>(PASSANT_SEED);   // per file of the pawn that can be taken
+
+    const key_type BLACK_TO_MOVE_KEY = 0xF1BB5A3C7E2D4C69ULL;  // xored in while black is at move
+
+    key_type generate_schema()
+    // return fingerprint of every key, keys stored by a build with other keys can not be looked up
+    {
+        key_type schema = BLACK_TO_MOVE_KEY;
+        auto fold = [&schema](key_type key){
+            key_type state = schema ^ key;
+            schema = next_random(state);
+        };
+
+        for (const auto& piece_keys : PIECE_KEYS)
+            for (const auto& key : piece_keys)
+                fold(key);
+        for (const auto& key : CASTLING_KEYS)
+            fold(key);
+        for (const auto& key : PASSANT_KEYS)
+            fold(key);
+        return schema;
+    }
+
+    const key_type SCHEMA = generate_schema();
+
+    int square_index(const chess_notation::ChessCoordinate& location)
+    {
+        return location.integer * chess_constants::CHESS_BOARD_SIZE + location.character;
+    }
+
+    int piece_index(const helper_classes::Piece& piece)
+    // Pre-Condition: piece is not an empty square
+    {
+        return static_cast<int>(piece.type) * 2 + static_cast<int>(piece.color);
+    }
+
+    key_type piece_key(const helper_classes::Piece& piece, const chess_notation::ChessCoordinate& location)
+    // return key of piece standing on location, empty squares do not change a key
+    {
+        if (piece.type == helper_classes::Piece_type::Empty)
+            return 0;
+        return PIECE_KEYS[piece_index(piece)][square_index(location)];
+    }
+
+    key_type castling_key(int color, int side)
+    // color 0 is white, side 0 the left rook
+    {
+        return CASTLING_KEYS[color * 2 + side];
+    }
+
+    key_type pawn_key(const helper_classes::Piece& piece, const chess_notation::ChessCoordinate& location)
+    // return key of piece if it is part of the pawn structure
+    {
+        if (piece.type != helper_classes::Piece_type::Pawn)
+            return 0;
+        return piece_key(piece, location);
+    }
+}
@@ -0,0 +1,197 @@
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+Client of the game server
+
+    client [socket path]
+        sends every line of stdin to the server and prints the replies
+
+    client <socket path> load <sessions> <active> <depth>
+        opens sessions idle games and lets the bot play both colors in active of them at once,
+        prints the number of bot moves per second when the active games are over
+*/
+
+const char* DEFAULT_SOCKET_PATH = "/tmp/chess.sock";
+const std::size_t READ_BUFFER_SIZE = 4096;
+const int LOAD_DEADLINE_MS = 5000;
+
+int connect_socket(const std::string& path)
+// return socket connected to the server at path or -1
+{
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        return -1;
+    path.copy(address.sun_path, path.size());
+
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool send_line(int fd, const std::string& line)
+{
+    const std::string message = line + "\n";
+    std::size_t sent = 0;
+    while (sent < message.size())
+    {
+        const ssize_t n = send(fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        sent += n;
+    }
+    return true;
+}
+
+class LineReader{
+public:
+    explicit LineReader(int descriptor)
+        :fd(descriptor) {   }
+
+    // read the next line into line, return false if the connection is closed
+    bool next(std::string& line)
+    {
+        std::size_t end;
+        while ((end = input.find('\n')) == std::string::npos)
+        {
+            char buffer[READ_BUFFER_SIZE];
+            const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0)
+                return false;
+            input.append(buffer, n);
+        }
+
+        line = input.substr(0, end);
+        input.erase(0, end + 1);
+        return true;
+    }
+
+private:
+    int fd;
+    std::string input;
+};
+
+int relay(int fd)
+// forward stdin to the server and the replies to stdout
+{
+    std::string input;
+
+    while (true)
+    {
+        pollfd descriptors[2] = {{STDIN_FILENO, POLLIN, 0}, {fd, POLLIN, 0}};
+        if (poll(descriptors, 2, -1) < 0)
+            return 1;
+
+        if (descriptors[0].revents & (POLLIN | POLLHUP))
+        {
+            std::string line;
+            if (!std::getline(std::cin, line))
+            {
+                shutdown(fd, SHUT_WR);
+                break;
+            }
+            send_line(fd, line);
+        }
+
+        if (descriptors[1].revents & (POLLIN | POLLHUP))
+        {
+            char buffer[READ_BUFFER_SIZE];
+            const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0)
+                return 0;
+            std::cout.write(buffer, n).flush();
+        }
+    }
+
+    // print the replies still on their way
+    char buffer[READ_BUFFER_SIZE];
+    ssize_t n;
+    while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+        std::cout.write(buffer, n).flush();
+    return 0;
+}
+
+int load(int fd, int sessions, int active, int depth)
+// open idle sessions and play bot against bot in the active ones
+{
+    LineReader reader{fd};
+    std::string line;
+
+    auto request_move = [fd, depth](int id){
+        send_line(fd, "go " + std::to_string(id) + " " + std::to_string(depth) + " " + std::to_string(LOAD_DEADLINE_MS));
+    };
+
+    for (int i = 0; i < sessions; ++i)
+    {
+        send_line(fd, "new");
+        if (!reader.next(line) || line.compare(0, 3, "ok ") != 0)
+        {
+            std::cerr << "session " << i << " not created: " << line << "\n";
+            return 1;
+        }
+    }
+    std::cout << sessions << " sessions open\n";
+
+    // the first sessions the server handed out have ids 1 to active
+    const auto start = std::chrono::steady_clock::now();
+    for (int id = 1; id <= active; ++id)
+        request_move(id);
+
+    std::size_t moves = 0;
+    int playing = active;
+    while (playing > 0 && reader.next(line))
+    {
+        std::istringstream is{line};
+        std::string kind;
+        int id;
+        is >> kind >> id;
+
+        if (kind == "bestmove")
+        {
+            ++moves;
+            request_move(id);
+        }
+        else
+        {
+            std::cout << line << "\n";
+            --playing;
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << moves << " bot moves in " << elapsed.count() << " s, "
+              << moves / elapsed.count() << " moves per second\n";
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const std::string path = (argc > 1) ? argv[1] : DEFAULT_SOCKET_PATH;
+
+    const int fd = connect_socket(path);
+    if (fd < 0)
+    {
+        std::cerr << "cannot connect to " << path << "\n";
+        return 1;
+    }
+
+    if (argc > 5 && std::string{argv[2]} == "load")
+        return load(fd, std::stoi(argv[3]), std::stoi(argv[4]), std::stoi(argv[5]));
+
+    return relay(fd);
+}
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chess_board.hpp"
+#include "chess_explorer.hpp"
+#include "chess_pgn.hpp"
+
+/*
+Opening explorer over a game archive
+
+    explorer build INDEX FILE.pgn... [--threads N] [--memory MB] [--plies N]
+        replays all finished games of the pgn files and writes the position index INDEX,
+        runs that do not fit into MB megabytes are sorted on disk next to INDEX,
+        --plies limits the indexed positions to the first N of every game
+
+    explorer query INDEX [FEN]
+        prints the moves played from FEN (default the initial position) and how those games ended
+*/
+
+int build(int argc, char** argv)
+{
+    std::vector<std::string> inputs;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t memory = explorer::DEFAULT_MEMORY;
+    std::size_t plies = 0;
+
+    for (int i = 3; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--threads" && i + 1 < argc)
+            threads = std::max(1, std::stoi(argv[++i]));
+        else if (argument == "--memory" && i + 1 < argc)
+            memory = std::stoull(argv[++i]) << 20;
+        else if (argument == "--plies" && i + 1 < argc)
+            plies = std::stoull(argv[++i]);
+        else
+            inputs.push_back(argument);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    explorer::Builder builder{argv[2], threads, memory, plies};
+    for (const auto& input : inputs)
+        builder.add_file(input);
+    const std::uint64_t records = builder.finish();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << builder.games() << " games, " << builder.broken_games() << " broken, "
+              << records << " records in " << elapsed.count() << " s\n";
+    return 0;
+}
+
+int query(int argc, char** argv)
+{
+    explorer::Index index{argv[2]};
+    cbn::ChessBoard board = (argc > 3) ? cbn::ChessBoard{std::string{argv[3]}} : cbn::ChessBoard{};
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<explorer::Continuation> moves = index.continuations(board);
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::sort(moves.begin(), moves.end(), [](const explorer::Continuation& lhs, const explorer::Continuation& rhs){
+        return lhs.games() > rhs.games();
+    });
+
+    for (const auto& continuation : moves)
+    {
+        const double games = static_cast<double>(continuation.games());
+        std::cout << std::left << std::setw(8) << pgn::san(board, continuation.move)
+                  << std::right << std::setw(10) << continuation.games() << " games"
+                  << std::fixed << std::setprecision(1)
+                  << "  white " << std::setw(5) << 100 * continuation.white_wins / games << "%"
+                  << "  draw " << std::setw(5) << 100 * continuation.draws / games << "%"
+                  << "  black " << std::setw(5) << 100 * continuation.black_wins / games << "%\n";
+    }
+    std::cout << moves.size() << " moves, lookup " << elapsed.count() << " us\n";
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const std::string command = (argc > 2) ? argv[1] : "";
+
+    try {
+        if (command == "build" && argc > 3)
+            return build(argc, argv);
+        if (command == "query")
+            return query(argc, argv);
+    }
+    catch (Exception& e)
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    std::cerr << "usage: explorer build INDEX FILE.pgn... [--threads N] [--memory MB] [--plies N]\n"
+                 "       explorer query INDEX [FEN]\n";
+    return 1;
+}
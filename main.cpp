@@ -1,3 +1,4 @@
+#include <chrono>
 #include <iostream>
 #include <vector>
 
@@ -15,8 +16,8 @@ std::ostream& operator<<(std::ostream& os, const std::pair<T,TT>& pair)
     return os;
 }
 
-template <typename T>
-std::ostream& operator<<(std::ostream& os, const std::vector<T>& v)
+template <typename T, typename A>
+std::ostream& operator<<(std::ostream& os, const std::vector<T, A>& v)
 {
     for (const auto& x : v)
         os << x << " ";
@@ -27,7 +28,11 @@ ChessBoard board{};
 Legalmoves legal{board};
 Engine bot{};
 
-const int COMPUTATION_DEPTH = 4;
+// the bot plays on a clock, every move of it adds the increment
+const int BOT_CLOCK_MS = 60 * 1000;
+const int BOT_INCREMENT_MS = 1000;
+
+TimeControl bot_clock{BOT_CLOCK_MS, BOT_INCREMENT_MS};
 
 int main(int size, char** argv)
 {
@@ -37,9 +42,20 @@ int main(int size, char** argv)
         // Bot is moving
         if (board.colors_turn() == Piece_color::Black)
         {
-            const auto notation = bot.best_notation(board, COMPUTATION_DEPTH);
-            const auto& move_list = legal.get_legal_moves(notation.from);
-            board.move(move_list, notation);
+            const auto start = std::chrono::steady_clock::now();
+            const auto result = bot.search(board, time_limits(bot_clock, start));
+            const auto spent = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+            bot_clock.remaining += BOT_INCREMENT_MS - static_cast<int>(spent.count());
+
+            const auto& move_list = legal.get_legal_moves(result.best.from);
+            board.move(move_list, result.best);
+
+            std::cout << "Bot plays - " << result.best << " (depth " << result.depth << ", " << spent.count() << " ms)\n";
+            std::cout << "Expected continuation - " << result.pv << "(score " << result.score << ")\n";
+
+            // think about the expected reply while the human is thinking
+            if (result.pv.size() > 1)
+                bot.start_ponder(board, result.pv[1]);
             continue;
         }
         
@@ -79,10 +95,11 @@ int main(int size, char** argv)
 
         if (board.is_checked(board.colors_turn()))
         {
-            if (board.is_game_over(board.colors_turn()))
+            if (!board.is_draw() && board.is_game_over(board.colors_turn()))
                 {
                     std::cout << "CHECKMATE\n";
                     board.restore();
+                    bot_clock.remaining = BOT_CLOCK_MS;
                 }
             else
                 std::cout << "Check\n";
@@ -0,0 +1,398 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chess_bot.hpp"
+#include "chess_board.hpp"
+#include "chess_pgn.hpp"
+
+/*
+Self-play match between two engine configurations
+
+    match [--games N] [--threads N] [--depth N] [--nodes N] [--time-ms N]
+          [--openings FILE.epd] [--pgn FILE] [--a SWITCHES] [--b SWITCHES] [--network FILE]
+          [--elo0 E] [--elo1 E] [--alpha A] [--beta B]
+
+SWITCHES names the selective search parts an engine uses, e.g. "null,lmr,see" (default) or "lmr" or "none",
+"see" prunes losing captures in the quiescence search and reduces them like quiet moves
+With --network engine A evaluates with the network of FILE, engine B keeps the hand written evaluation
+Every opening of the EPD file is played twice with colors swapped, without one all games start from the initial position
+After every game the running score of engine A, its Elo estimate and the SPRT of elo0 against elo1 are printed,
+no new games are started once the SPRT accepted a hypothesis
+*/
+
+using namespace cbn;
+using namespace lmn;
+using namespace cbot;
+
+const int DEFAULT_GAMES = 100;
+const int DEFAULT_DEPTH = 4;
+
+const double ADJUDICATE_WIN_SCORE = 10;     // pawns up to call the game won
+const int ADJUDICATE_WIN_PLIES = 8;         // plies in a row the score has to stay above it
+const double ADJUDICATE_DRAW_SCORE = 0.05;
+const int ADJUDICATE_DRAW_PLIES = 16;
+const int ADJUDICATE_DRAW_MIN_PLY = 80;     // draws are not adjudicated in the opening and middlegame
+const int MAX_GAME_PLIES = 400;             // longer games are drawn
+
+const double CONFIDENCE_Z = 1.96;           // 95% interval of the Elo estimate
+
+struct MatchConfig
+{
+    int games = DEFAULT_GAMES;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    SearchLimits limits;
+    int time_ms = 0;                // time per move, 0 --> no time limit
+    std::string openings_file;
+    std::string pgn_file;
+    std::string a_name = "null,lmr,see";
+    std::string b_name = "null,lmr,see";
+    std::string network_file;
+    double elo0 = 0;
+    double elo1 = 5;
+    double alpha = 0.05;
+    double beta = 0.05;
+};
+
+struct MatchScore
+// games seen from engine A
+{
+    std::size_t wins = 0;
+    std::size_t draws = 0;
+    std::size_t losses = 0;
+
+    std::size_t games() const { return wins + draws + losses; }
+};
+
+struct GameOutcome
+{
+    pgn::GameRecord record;
+    Piece_color loser = Piece_color::Neutral;  // Neutral --> draw
+};
+
+SearchOptions parse_switches(const std::string& switches)
+// return options with the parts named in switches turned on
+{
+    SearchOptions options;
+    options.null_move = switches.find("null") != std::string::npos;
+    options.late_move_reductions = switches.find("lmr") != std::string::npos;
+    options.see_pruning = switches.find("see") != std::string::npos;
+    return options;
+}
+
+double expected_score(double elo)
+{
+    return 1 / (1 + std::pow(10, -elo / 400));
+}
+
+double elo_of_score(double score)
+// return Elo difference that makes score the expected score, scores of 0 and 1 are clamped
+{
+    score = std::min(std::max(score, 1e-6), 1 - 1e-6);
+    return -400 * std::log10(1 / score - 1);
+}
+
+double score_variance(const MatchScore& score, double mean)
+// return variance of a single game score
+{
+    const double n = score.games();
+    return (score.wins * std::pow(1 - mean, 2) + score.draws * std::pow(0.5 - mean, 2) + score.losses * std::pow(mean, 2)) / n;
+}
+
+double sprt_llr(const MatchScore& score, double elo0, double elo1)
+// log likelihood ratio of elo1 against elo0, game scores approximated by a normal distribution
+{
+    const double n = score.games();
+    if (n == 0)
+        return 0;
+
+    const double mean = (score.wins + 0.5 * score.draws) / n;
+    const double variance = score_variance(score, mean);
+    if (variance <= 0)
+        return 0;
+
+    const double s0 = expected_score(elo0);
+    const double s1 = expected_score(elo1);
+    return n * (s1 - s0) * (2 * mean - s0 - s1) / (2 * variance);
+}
+
+std::string today()
+{
+    const std::time_t now = std::time(nullptr);
+    std::ostringstream os;
+    os << std::put_time(std::localtime(&now), "%Y.%m.%d");
+    return os.str();
+}
+
+GameOutcome play_game(Engine& white, Engine& black, const std::string& opening, const MatchConfig& config)
+// play one game from opening (FEN, empty --> initial position)
+{
+    GameOutcome outcome;
+    ChessBoard board = opening.empty() ? ChessBoard{} : ChessBoard{opening};
+
+    Piece_color leader = Piece_color::Neutral;
+    int win_plies = 0;
+    int draw_plies = 0;
+    std::string termination = "normal";
+
+    for (int ply = 0; ; ++ply)
+    {
+        const Piece_color us = board.colors_turn();
+
+        if (board.is_game_over(us))
+        {
+            if (!board.is_draw() && board.is_checked(us))
+                outcome.loser = us;
+            break;
+        }
+
+        if (ply >= MAX_GAME_PLIES)
+        {
+            termination = "adjudication";
+            break;
+        }
+
+        SearchLimits limits = config.limits;
+        if (config.time_ms > 0)
+            limits.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(config.time_ms);
+
+        Engine& engine = (us == Piece_color::White) ? white : black;
+        const SearchResult result = engine.search(board, limits);
+
+        // adjudication --> the score has to stay decisive or drawish for several plies
+        const Piece_color better = (result.score > 0) ? us : enemy_color.at(us);
+        if (std::abs(result.score) >= ADJUDICATE_WIN_SCORE)
+        {
+            win_plies = (better == leader) ? win_plies + 1 : 1;
+            leader = better;
+        }
+        else
+            win_plies = 0;
+
+        draw_plies = (std::abs(result.score) <= ADJUDICATE_DRAW_SCORE) ? draw_plies + 1 : 0;
+
+        outcome.record.moves.push_back(pgn::san(board, result.best));
+
+        Legalmoves legal{board};
+        board.move(legal.get_legal_moves(result.best.from), result.best);
+
+        if (win_plies >= ADJUDICATE_WIN_PLIES)
+        {
+            outcome.loser = enemy_color.at(leader);
+            termination = "adjudication";
+            break;
+        }
+        if (ply >= ADJUDICATE_DRAW_MIN_PLY && draw_plies >= ADJUDICATE_DRAW_PLIES)
+        {
+            termination = "adjudication";
+            break;
+        }
+    }
+
+    outcome.record.result = pgn::result_of_loser(outcome.loser);
+    outcome.record.tags.emplace_back("Termination", termination);
+    return outcome;
+}
+
+std::vector<std::string> read_openings(const std::string& file)
+// return FEN of every position in the EPD file, throws BadFenError on a broken line
+{
+    std::vector<std::string> openings;
+    std::ifstream is{file};
+    std::string line;
+
+    while (std::getline(is, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        openings.push_back(ChessBoard{line}.fen());
+    }
+    return openings;
+}
+
+bool parse_arguments(int argc, char** argv, MatchConfig& config)
+// return false on an unknown option
+{
+    config.limits.depth = DEFAULT_DEPTH;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string option = argv[i];
+        const std::string value = argv[i + 1];
+
+        if (option == "--games")
+            config.games = std::stoi(value);
+        else if (option == "--threads")
+            config.threads = std::max(1, std::stoi(value));
+        else if (option == "--depth")
+            config.limits.depth = std::min(std::stoi(value), MAX_SEARCH_DEPTH - 1);
+        else if (option == "--nodes")
+        {
+            config.limits.nodes = std::stoul(value);
+            config.limits.depth = MAX_SEARCH_DEPTH - 1;
+        }
+        else if (option == "--time-ms")
+        {
+            config.time_ms = std::stoi(value);
+            config.limits.depth = MAX_SEARCH_DEPTH - 1;
+        }
+        else if (option == "--openings")
+            config.openings_file = value;
+        else if (option == "--pgn")
+            config.pgn_file = value;
+        else if (option == "--a")
+            config.a_name = value;
+        else if (option == "--b")
+            config.b_name = value;
+        else if (option == "--network")
+            config.network_file = value;
+        else if (option == "--elo0")
+            config.elo0 = std::stod(value);
+        else if (option == "--elo1")
+            config.elo1 = std::stod(value);
+        else if (option == "--alpha")
+            config.alpha = std::stod(value);
+        else if (option == "--beta")
+            config.beta = std::stod(value);
+        else
+            return false;
+    }
+    return argc % 2 == 1;
+}
+
+int main(int argc, char** argv)
+{
+    MatchConfig config;
+    if (!parse_arguments(argc, argv, config))
+    {
+        std::cerr << "usage: match [--games N] [--threads N] [--depth N] [--nodes N] [--time-ms N] [--openings FILE] "
+                     "[--pgn FILE] [--a SWITCHES] [--b SWITCHES] [--network FILE] [--elo0 E] [--elo1 E] [--alpha A] [--beta B]\n";
+        return 1;
+    }
+
+    std::vector<std::string> openings{""};
+    if (!config.openings_file.empty())
+    {
+        try {
+            openings = read_openings(config.openings_file);
+        }
+        catch (Exception& e)
+        {
+            std::cerr << config.openings_file << ": " << e.what() << "\n";
+            return 1;
+        }
+        if (openings.empty())
+            openings.push_back("");
+    }
+
+    std::shared_ptr<const nnue::Network> network;
+    if (!config.network_file.empty())
+    {
+        try {
+            network = nnue::load_network(config.network_file);
+        }
+        catch (Exception& e)
+        {
+            std::cerr << config.network_file << ": " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    std::ofstream pgn_output;
+    if (!config.pgn_file.empty())
+        pgn_output.open(config.pgn_file, std::ios::app);
+
+    const double lower_bound = std::log(config.beta / (1 - config.alpha));
+    const double upper_bound = std::log((1 - config.beta) / config.alpha);
+    const std::string date = today();
+
+    std::mutex result_mutex;
+    MatchScore score;
+    bool decided = false;
+    std::atomic<int> next_game{0};
+
+    auto worker = [&]{
+        Engine a{parse_switches(config.a_name), network};
+        Engine b{parse_switches(config.b_name)};
+
+        int game;
+        while ((game = next_game++) < config.games)
+        {
+            {
+                std::lock_guard<std::mutex> lock(result_mutex);
+                if (decided)
+                    return;
+            }
+
+            // every opening twice, A has white in the first game of the pair
+            const std::string& opening = openings[(game / 2) % openings.size()];
+            const bool a_white = game % 2 == 0;
+
+            GameOutcome outcome = a_white ? play_game(a, b, opening, config) : play_game(b, a, opening, config);
+
+            const std::string a_label = "A (" + config.a_name + ")";
+            const std::string b_label = "B (" + config.b_name + ")";
+            std::vector<std::pair<std::string, std::string>> tags{
+                {"Event", "self-play match"}, {"Site", "local"}, {"Date", date}, {"Round", std::to_string(game + 1)},
+                {"White", a_white ? a_label : b_label}, {"Black", a_white ? b_label : a_label}, {"Result", outcome.record.result}
+            };
+            if (!opening.empty())
+            {
+                tags.emplace_back("SetUp", "1");
+                tags.emplace_back("FEN", opening);
+            }
+            tags.insert(tags.end(), outcome.record.tags.begin(), outcome.record.tags.end());
+            outcome.record.tags = tags;
+
+            std::lock_guard<std::mutex> lock(result_mutex);
+
+            const Piece_color a_color = a_white ? Piece_color::White : Piece_color::Black;
+            if (outcome.loser == Piece_color::Neutral)
+                ++score.draws;
+            else if (outcome.loser == a_color)
+                ++score.losses;
+            else
+                ++score.wins;
+
+            if (pgn_output)
+                pgn::write_game(pgn_output, outcome.record);
+
+            const double n = score.games();
+            const double mean = (score.wins + 0.5 * score.draws) / n;
+            const double margin = CONFIDENCE_Z * std::sqrt(score_variance(score, mean) / n);
+            const double llr = sprt_llr(score, config.elo0, config.elo1);
+
+            std::cout << "game " << game + 1 << ": " << outcome.record.result
+                      << " | A +" << score.wins << " =" << score.draws << " -" << score.losses
+                      << " | elo " << std::fixed << std::setprecision(1) << elo_of_score(mean)
+                      << " [" << elo_of_score(mean - margin) << ", " << elo_of_score(mean + margin) << "]"
+                      << " | LLR " << std::setprecision(2) << llr << " (" << lower_bound << ", " << upper_bound << ")\n";
+
+            if (!decided && (llr <= lower_bound || llr >= upper_bound))
+            {
+                decided = true;
+                std::cout << "SPRT: " << (llr >= upper_bound ? "H1" : "H0") << " accepted (elo0 " << config.elo0
+                          << ", elo1 " << config.elo1 << ")\n";
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < config.threads; ++i)
+        workers.emplace_back(worker);
+    for (auto& thread : workers)
+        thread.join();
+
+    const double llr = sprt_llr(score, config.elo0, config.elo1);
+    if (!decided)
+        std::cout << "SPRT: no decision after " << score.games() << " games (LLR " << llr << ")\n";
+}
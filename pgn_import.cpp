@@ -0,0 +1,95 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "chess_board.hpp"
+#include "chess_pgn.hpp"
+#include "MappedFile.hpp"
+
+/*
+PGN importer
+
+    pgn_import FILE.pgn [--roundtrip] [--labels OUT.epd]
+
+Reads every game of the memory mapped FILE, plays its moves on a board and prints counts and throughput
+With --roundtrip the SAN of every move is generated again and compared with the file
+With --labels every position of a finished game is written to OUT.epd with the game result, c9 "1-0", the input of tune
+*/
+
+const int SHOWN_ERRORS = 5;     // broken games printed before only counting them
+
+std::string_view without_annotation(std::string_view san)
+{
+    while (!san.empty() && (san.back() == '!' || san.back() == '?'))
+        san.remove_suffix(1);
+    return san;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: pgn_import FILE.pgn [--roundtrip] [--labels OUT.epd]\n";
+        return 1;
+    }
+    bool roundtrip = false;
+    std::ofstream labels;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--roundtrip")
+            roundtrip = true;
+        else if (argument == "--labels" && i + 1 < argc)
+            labels.open(argv[++i]);
+    }
+
+    try {
+        io::MappedFile file{argv[1]};
+        pgn::Reader reader{file.data()};
+        pgn::GameRecord game;
+
+        std::size_t games = 0, plies = 0, broken = 0, mismatches = 0;
+        const auto start = std::chrono::steady_clock::now();
+
+        while (reader.next(game))
+        {
+            ++games;
+            try {
+                cbn::ChessBoard board = pgn::start_position(game);
+                std::size_t ply = 0;
+                const bool labelled = labels.is_open() && (game.result == "1-0" || game.result == "0-1" || game.result == "1/2-1/2");
+
+                pgn::replay(game, board, [&](cbn::ChessBoard& position, const cbn::ChessNotation& move){
+                    if (roundtrip && pgn::san(position, move) != without_annotation(game.moves[ply]))
+                    {
+                        if (mismatches++ < SHOWN_ERRORS)
+                            std::cerr << "game " << games << ": " << game.moves[ply] << " written as " << pgn::san(position, move) << "\n";
+                    }
+                    if (labelled)
+                        labels << position.fen() << " c9 \"" << game.result << "\";\n";
+                    ++ply;
+                });
+                plies += ply;
+            }
+            catch (Exception& e)
+            {
+                if (broken++ < SHOWN_ERRORS)
+                    std::cerr << "game " << games << " at byte " << reader.position() << ": " << e.what() << "\n";
+            }
+        }
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << games << " games, " << plies << " plies, " << broken << " broken";
+        if (roundtrip)
+            std::cout << ", " << mismatches << " SAN mismatches";
+        std::cout << "\n" << elapsed.count() << " s, " << static_cast<std::size_t>(games / elapsed.count() * 60) << " games per minute\n";
+    }
+    catch (Exception& e)
+    {
+        std::cerr << argv[1] << ": " << e.what() << "\n";
+        return 1;
+    }
+}
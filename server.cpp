@@ -0,0 +1,638 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "chess_bot.hpp"
+#include "chess_board.hpp"
+
+/*
+Game server
+
+Holds many independent games in one process and serves them over a local socket
+Every request and reply is one line of text, replies carry the session id
+so one connection can play many games at once
+
+    new                                 --> ok <id>
+    move <id> <from> <to>               --> ok <id>                     e.g. "move 1 e7 e5"
+    go <id> <depth> [deadline in ms]    --> bestmove <id> <from> <to>   bot move is played on the session
+    state <id>                          --> ok <id> <white|black> <playing|over> <moves played>
+    close <id>                          --> ok <id>
+    counters                            --> ok 0 <name>=<value>...       hot path counters, needs a build with -DCHESS_COUNTERS
+    anything going wrong                --> error <id> <reason>
+
+Bot searches run on a bounded pool of worker threads, each owning an engine
+Queued searches are taken from the connections in turn, so one busy client does not starve the others
+A connection that closes cancels its queued and running searches, their workers are free again within milliseconds
+Replies are queued per connection and sent without blocking, the io thread sends the rest once the socket is writable
+A client letting more than MAX_OUTPUT_SIZE bytes of replies pile up is dropped
+
+    server [socket path] [threads] [table snapshot]
+
+Engines start from the transposition table snapshot if one is given (see Engine::save_table),
+its pages are shared by all workers and server processes until a worker overwrites them
+*/
+
+using namespace cbn;
+using namespace lmn;
+using namespace cbot;
+
+using server_clock = std::chrono::steady_clock;
+
+const char* DEFAULT_SOCKET_PATH = "/tmp/chess.sock";
+
+const std::size_t MAX_SESSIONS = 100000;
+const std::size_t MAX_QUEUED_SEARCHES = 4096;
+const int MAX_REQUEST_DEPTH = 8;
+const int DEFAULT_DEADLINE_MS = 1000;   // deadline of a go request without one, counted from its arrival
+const std::size_t MAX_LINE_LENGTH = 256;
+const std::size_t READ_BUFFER_SIZE = 4096;
+const std::size_t MAX_OUTPUT_SIZE = 1 << 16;
+const int LISTEN_BACKLOG = 128;
+
+class Connection{
+public:
+    Connection(int descriptor, std::size_t i, int wake)
+        :fd(descriptor), id(i), wake_fd(wake) {   }
+
+    ~Connection()
+    {
+        close(fd);
+    }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    // queue line and send what the socket takes, never blocks
+    void send_line(const std::string& line);
+
+    // send queued bytes the socket takes
+    void flush();
+
+    bool has_output();
+
+    // return true if a send failed or the replies piled up beyond MAX_OUTPUT_SIZE
+    bool dropped();
+
+    const int fd;
+    const std::size_t id;       // unlike fd never reused while the server runs
+    std::string input;          // received bytes after the last complete line, only touched by the io thread
+    bool closing = false;
+    CancellationToken searches; // cancelled on close, stops the queued and running searches of the connection
+
+private:
+    void send_output();
+
+    const int wake_fd;          // written to wake the io thread when a worker leaves output behind
+    std::mutex write_mutex;     // replies come from the io thread and from the workers
+    std::string output;         // queued bytes the socket did not take yet, guarded by write_mutex
+    bool broken = false;        // guarded by write_mutex
+};
+
+struct Session
+{
+    ChessBoard board;
+    bool searching = false;     // a bot search for the session is queued or running
+};
+
+class SessionStore{
+public:
+    // return id of the new session or 0 if there is no room
+    int create();
+
+    void erase(int id);
+
+    std::mutex mutex;   // guards sessions and every board in it
+    std::unordered_map<int, std::unique_ptr<Session>> sessions;
+
+private:
+    int next_id = 1;
+};
+
+struct SearchJob
+{
+    std::shared_ptr<Connection> client;
+    int session = 0;
+    ChessBoard board;           // copy of the session board when the request arrived
+    int depth = 0;
+    server_clock::time_point deadline;
+};
+
+class WorkerPool{
+public:
+    WorkerPool(unsigned threads, SessionStore& s, const std::string& table_snapshot);
+
+    ~WorkerPool();
+
+    // return false if the queue is full
+    bool submit(SearchJob&& job);
+
+private:
+    void work();
+
+    bool next_job(SearchJob& job);
+
+    void finish(Engine& engine, SearchJob& job);
+
+    SessionStore& store;
+    std::string snapshot;   // loaded by every engine, empty for cold engines
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable job_added;
+    bool stopping = false;
+
+    // one queue per connection, served round robin
+    std::map<std::size_t, std::deque<SearchJob>> queues;
+    std::size_t queued = 0;
+    std::size_t last_served = 0;    // connection id the last job was taken from
+};
+
+/**************************************************************************************Function definition*******************************************************************/
+
+void Connection::send_line(const std::string& line)
+{
+    {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        if (broken)
+            return;
+
+        output += line;
+        output += '\n';
+        send_output();
+
+        if (output.size() > MAX_OUTPUT_SIZE)
+            broken = true;
+        if (output.empty() && !broken)
+            return;
+    }
+
+    // the io thread only polls for writability of connections it knows to hold output
+    const char wake = 0;
+    send(wake_fd, &wake, 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+}
+
+void Connection::flush()
+{
+    std::lock_guard<std::mutex> lock(write_mutex);
+    send_output();
+}
+
+bool Connection::has_output()
+{
+    std::lock_guard<std::mutex> lock(write_mutex);
+    return !output.empty();
+}
+
+bool Connection::dropped()
+{
+    std::lock_guard<std::mutex> lock(write_mutex);
+    return broken;
+}
+
+void Connection::send_output()
+// Pre-Condition: write_mutex is locked
+{
+    while (!broken && !output.empty())
+    {
+        const ssize_t n = send(fd, output.data(), output.size(), MSG_NOSIGNAL);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;     // socket buffer is full, the rest waits for POLLOUT
+
+        if (n <= 0)
+        {
+            // client is gone, the io thread closes the connection
+            broken = true;
+            output.clear();
+            return;
+        }
+        output.erase(0, n);
+    }
+}
+
+int SessionStore::create()
+// Pre-Condition: mutex is locked
+{
+    if (sessions.size() >= MAX_SESSIONS)
+        return 0;
+
+    const int id = next_id++;
+    sessions.emplace(id, std::make_unique<Session>());
+    return id;
+}
+
+void SessionStore::erase(int id)
+// Pre-Condition: mutex is locked
+{
+    sessions.erase(id);
+}
+
+WorkerPool::WorkerPool(unsigned threads, SessionStore& s, const std::string& table_snapshot)
+    :store(s), snapshot(table_snapshot)
+{
+    for (unsigned i = 0; i < threads; ++i)
+        workers.emplace_back([this]{ work(); });
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    job_added.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+bool WorkerPool::submit(SearchJob&& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queued >= MAX_QUEUED_SEARCHES)
+            return false;
+
+        queues[job.client->id].push_back(std::move(job));
+        ++queued;
+    }
+    job_added.notify_one();
+    return true;
+}
+
+bool WorkerPool::next_job(SearchJob& job)
+// wait for a job, take it from the connection following the last served one
+// return false if the pool is stopping
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    job_added.wait(lock, [this]{ return stopping || queued > 0; });
+
+    if (stopping)
+        return false;
+
+    auto queue = queues.upper_bound(last_served);
+    if (queue == queues.end())
+        queue = queues.begin();
+
+    job = std::move(queue->second.front());
+    queue->second.pop_front();
+    --queued;
+
+    last_served = queue->first;
+    if (queue->second.empty())
+        queues.erase(queue);
+
+    return true;
+}
+
+void WorkerPool::work()
+{
+    // searches of a worker share one engine, the transposition table stays warm across games
+    Engine engine{};
+    SearchJob job;
+
+    if (!snapshot.empty())
+    {
+        try {
+            engine.load_table(snapshot);
+        }
+        catch (Exception& e)
+        {
+            std::cerr << snapshot << ": " << e.what() << ", starting cold\n";
+        }
+    }
+
+    while (next_job(job))
+    {
+        finish(engine, job);
+        job.client.reset();     // a closed connection is released without waiting for the next job
+    }
+}
+
+void WorkerPool::finish(Engine& engine, SearchJob& job)
+// search the job, play the found move on its session and reply to the client
+{
+    const std::string id = std::to_string(job.session);
+    const bool expired = server_clock::now() >= job.deadline;
+
+    SearchLimits limits;
+    limits.depth = job.depth;
+    limits.deadline = job.deadline;
+    limits.cancel = job.client->searches;
+
+    SearchResult result;
+    if (!expired && !limits.cancel.cancelled())
+        result = engine.search(job.board, limits);
+
+    std::string reply;
+    {
+        std::lock_guard<std::mutex> lock(store.mutex);
+        auto session = store.sessions.find(job.session);
+
+        // nobody is left to read the reply, the cut short search does not get to move
+        const bool cancelled = limits.cancel.cancelled();
+
+        if (session == store.sessions.end())
+        {
+            // session was closed while the job waited or searched
+            if (cancelled)
+                return;
+            reply = "error " + id + " closed";
+        }
+        else
+        {
+            session->second->searching = false;
+
+            if (cancelled)
+                return;
+
+            if (expired)
+                reply = "error " + id + " timeout";
+            else if (result.depth == 0)
+                reply = "error " + id + " game over";
+            else
+            {
+                ChessBoard& board = session->second->board;
+                Legalmoves legal{board};
+                board.move(legal.get_legal_moves(result.best.from), result.best);
+
+                std::ostringstream os;
+                os << "bestmove " << id << " " << result.best.from << " " << result.best.to;
+                reply = os.str();
+            }
+        }
+    }
+
+    job.client->send_line(reply);
+}
+
+std::string handle_request(const std::string& line, const std::shared_ptr<Connection>& client, SessionStore& store, WorkerPool& pool)
+// return reply of a request answered right away or an empty string if a worker replies later
+{
+    std::istringstream is{line};
+    std::string command;
+    int id = 0;
+
+    is >> command;
+
+    if (command == "new")
+    {
+        std::lock_guard<std::mutex> lock(store.mutex);
+        id = store.create();
+        if (id == 0)
+            return "error 0 too many sessions";
+        return "ok " + std::to_string(id);
+    }
+
+    if (command == "counters")
+    {
+        if (!counters::ENABLED)
+            return "error 0 counters disabled";
+
+        const counters::snapshot_type sums = counters::snapshot();
+        std::ostringstream os;
+        os << "ok 0";
+        for (int counter = 0; counter < counters::COUNTER_COUNT; ++counter)
+            os << ' ' << counters::COUNTER_NAMES[counter] << '=' << sums[counter];
+        return os.str();
+    }
+
+    if (!(is >> id))
+        return "error 0 bad request";
+
+    const std::string prefix = std::to_string(id);
+
+    std::lock_guard<std::mutex> lock(store.mutex);
+    auto found = store.sessions.find(id);
+    if (found == store.sessions.end())
+        return "error " + prefix + " unknown session";
+
+    Session& session = *found->second;
+
+    if (command == "close")
+    {
+        store.erase(id);
+        return "ok " + prefix;
+    }
+
+    if (command == "state")
+    {
+        const bool over = session.board.is_game_over(session.board.colors_turn());
+
+        std::ostringstream os;
+        os << "ok " << prefix << (session.board.colors_turn() == Piece_color::White ? " white " : " black ")
+           << (over ? "over" : "playing") << " " << session.board.get_history().size();
+        return os.str();
+    }
+
+    if (session.searching)
+        return "error " + prefix + " busy";
+
+    if (command == "move")
+    {
+        // malformed or illegal moves are answered without throwing
+        std::string from, to;
+        is >> from >> to;
+
+        const std::optional<ChessNotation> move = parse_move(from + to);
+        if (!move)
+            return "error " + prefix + " bad request";
+
+        if (session.board.try_move(*move) != MoveError::None)
+            return "error " + prefix + " illegal move";
+        return "ok " + prefix;
+    }
+
+    if (command == "go")
+    {
+        int depth = 0;
+        int deadline_ms = DEFAULT_DEADLINE_MS;
+
+        if (!(is >> depth) || depth < 1)
+            return "error " + prefix + " bad request";
+        is >> deadline_ms;
+
+        if (session.board.is_game_over(session.board.colors_turn()))
+            return "error " + prefix + " game over";
+
+        SearchJob job;
+        job.client = client;
+        job.session = id;
+        job.board = session.board;
+        job.depth = std::min(depth, MAX_REQUEST_DEPTH);
+        job.deadline = server_clock::now() + std::chrono::milliseconds(deadline_ms);
+
+        if (!pool.submit(std::move(job)))
+            return "error " + prefix + " server busy";
+
+        session.searching = true;
+        return "";
+    }
+
+    return "error " + prefix + " bad request";
+}
+
+int open_socket(const std::string& path)
+// return listening socket bound to path or -1
+{
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        return -1;
+    path.copy(address.sun_path, path.size());
+
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(fd, LISTEN_BACKLOG) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool set_non_blocking(int fd)
+{
+    const int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) >= 0;
+}
+
+void read_requests(const std::shared_ptr<Connection>& client, SessionStore& store, WorkerPool& pool)
+// answer every complete line received on client
+{
+    char buffer[READ_BUFFER_SIZE];
+    const ssize_t n = recv(client->fd, buffer, sizeof(buffer), 0);
+
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return;
+
+    if (n <= 0)
+    {
+        client->closing = true;
+        return;
+    }
+
+    client->input.append(buffer, n);
+
+    std::size_t begin = 0;
+    std::size_t end;
+    while ((end = client->input.find('\n', begin)) != std::string::npos)
+    {
+        std::string line = client->input.substr(begin, end - begin);
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        const std::string reply = handle_request(line, client, store, pool);
+        if (!reply.empty())
+            client->send_line(reply);
+
+        begin = end + 1;
+    }
+    client->input.erase(0, begin);
+
+    if (client->input.size() > MAX_LINE_LENGTH)
+    {
+        client->send_line("error 0 line too long");
+        client->closing = true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::string path = (argc > 1) ? argv[1] : DEFAULT_SOCKET_PATH;
+    const unsigned threads = (argc > 2) ? std::stoul(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+    const std::string snapshot = (argc > 3) ? argv[3] : "";
+
+    const int listener = open_socket(path);
+    if (listener < 0)
+    {
+        std::cerr << "cannot listen on " << path << "\n";
+        return 1;
+    }
+
+    // senders write to wake[1] when they leave output behind, poll watches wake[0]
+    int wake[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, wake) < 0 || !set_non_blocking(wake[0]) || !set_non_blocking(wake[1]))
+    {
+        std::cerr << "cannot create the wake up socket\n";
+        return 1;
+    }
+
+    SessionStore store;
+    WorkerPool pool{threads, store, snapshot};
+
+    std::vector<std::shared_ptr<Connection>> clients;
+    std::size_t next_client_id = 1;
+
+    std::cout << "serving on " << path << " with " << threads << " search threads\n";
+
+    const std::size_t FIRST_CLIENT = 2;    // descriptors behind the listener and the wake up socket
+
+    while (true)
+    {
+        std::vector<pollfd> descriptors{pollfd{listener, POLLIN, 0}, pollfd{wake[0], POLLIN, 0}};
+        for (const auto& client : clients)
+            descriptors.push_back(pollfd{client->fd, static_cast<short>(client->has_output() ? POLLIN | POLLOUT : POLLIN), 0});
+
+        if (poll(descriptors.data(), descriptors.size(), -1) < 0)
+            continue;
+
+        if (descriptors[1].revents & POLLIN)
+        {
+            char drained[READ_BUFFER_SIZE];
+            while (recv(wake[0], drained, sizeof(drained), 0) > 0) {   }
+        }
+
+        for (std::size_t i = FIRST_CLIENT; i < descriptors.size(); ++i)
+        {
+            const auto& client = clients[i - FIRST_CLIENT];
+            if (descriptors[i].revents & POLLOUT)
+                client->flush();
+            if (descriptors[i].revents & (POLLIN | POLLHUP | POLLERR))
+                read_requests(client, store, pool);
+        }
+
+        // workers may still hold a closing connection, its descriptor is closed with the last reference
+        for (auto& client : clients)
+        {
+            if (client->dropped())
+                client->closing = true;
+
+            if (client->closing)
+            {
+                client->searches.cancel();
+                shutdown(client->fd, SHUT_RDWR);
+            }
+        }
+        clients.erase(std::remove_if(clients.begin(), clients.end(), [](const auto& client){ return client->closing; }), clients.end());
+
+        if (descriptors[0].revents & POLLIN)
+        {
+            const int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0 && !set_non_blocking(fd))
+                close(fd);
+            else if (fd >= 0)
+                clients.push_back(std::make_shared<Connection>(fd, next_client_id++, wake[1]));
+        }
+    }
+}
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "chess_trace.hpp"
+
+/*
+Summary of a search trace written by Engine::start_trace (bench --trace FILE in a build with -DCHESS_TRACE)
+
+    trace_report FILE.trace [--chrome OUT.json]
+
+Prints per thread the nodes of every node type, how often the first move already failed high,
+how the nodes spread over the plies and what every iteration cost.
+--chrome writes the iterations of all threads as a timeline for chrome://tracing or Perfetto
+*/
+
+const int CUTOFF_BUCKETS = 8;  // cutoffs at move index 0 to 6 and at 7 or later
+
+struct Iteration
+{
+    std::uint32_t thread;
+    std::uint64_t start;    // microseconds since the trace began
+    std::uint32_t span;
+    int depth;
+    float score;
+    std::uint64_t nodes;    // node records since the previous iteration of the thread
+};
+
+double percent(std::uint64_t part, std::uint64_t whole)
+{
+    return whole == 0 ? 0 : 100.0 * part / whole;
+}
+
+std::vector<Iteration> summarize(const trace::ThreadTrace& thread)
+// print the statistics of thread, return its iterations
+{
+    std::array<std::uint64_t, 3> types{};
+    std::array<std::uint64_t, CUTOFF_BUCKETS> cutoffs{};
+    std::vector<std::uint64_t> plies;
+    std::vector<Iteration> iterations;
+    std::uint64_t nodes = 0, iteration_nodes = 0;
+
+    for (const auto& record : thread.records)
+    {
+        if (record.kind == trace::Kind::Iteration)
+        {
+            iterations.push_back(Iteration{thread.thread, record.stamp, record.span, record.depth, record.score, iteration_nodes});
+            iteration_nodes = 0;
+            continue;
+        }
+
+        ++nodes;
+        ++iteration_nodes;
+        ++types[static_cast<int>(record.type)];
+        if (record.cutoff != trace::NO_CUTOFF)
+            ++cutoffs[std::min<int>(record.cutoff, CUTOFF_BUCKETS - 1)];
+        if (plies.size() <= record.ply)
+            plies.resize(record.ply + 1);
+        ++plies[record.ply];
+    }
+
+    std::uint64_t cutoff_count = 0;
+    for (auto count : cutoffs)
+        cutoff_count += count;
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "thread " << thread.thread << ": " << nodes << " nodes, " << thread.dropped << " records dropped\n"
+              << "  pv " << types[0] << " (" << percent(types[0], nodes) << "%)"
+              << "  cut " << types[1] << " (" << percent(types[1], nodes) << "%)"
+              << "  all " << types[2] << " (" << percent(types[2], nodes) << "%)\n"
+              << "  cutoff at move index:";
+    for (int index = 0; index < CUTOFF_BUCKETS; ++index)
+        std::cout << "  " << index << (index == CUTOFF_BUCKETS - 1 ? "+ " : " ") << percent(cutoffs[index], cutoff_count) << "%";
+
+    std::cout << "\n  nodes per ply:";
+    for (std::size_t ply = 0; ply < plies.size(); ++ply)
+        if (plies[ply] > 0)
+            std::cout << "  " << ply << ": " << plies[ply];
+
+    std::cout << "\n";
+    for (const auto& iteration : iterations)
+        std::cout << "  depth " << iteration.depth << ": " << iteration.nodes << " nodes " << iteration.span / 1000.0 << " ms"
+                  << " score " << iteration.score << "\n";
+
+    return iterations;
+}
+
+void write_chrome(const std::vector<Iteration>& iterations, const std::string& path)
+// one complete event per iteration, a row per search thread
+{
+    std::ofstream out(path);
+    out << "{\"traceEvents\":[";
+    for (std::size_t i = 0; i < iterations.size(); ++i)
+    {
+        const Iteration& iteration = iterations[i];
+        out << (i == 0 ? "\n" : ",\n")
+            << "{\"name\":\"depth " << iteration.depth << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << iteration.thread
+            << ",\"ts\":" << iteration.start << ",\"dur\":" << iteration.span
+            << ",\"args\":{\"nodes\":" << iteration.nodes << ",\"score\":" << iteration.score << "}}";
+    }
+    out << "\n]}\n";
+
+    if (!out)
+        throw trace::TraceWriteError;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2 && !(argc == 4 && std::string{argv[2]} == "--chrome"))
+    {
+        std::cerr << "usage: trace_report FILE.trace [--chrome OUT.json]\n";
+        return 1;
+    }
+
+    try {
+        std::vector<Iteration> iterations;
+        for (const auto& thread : trace::read_trace(argv[1]))
+        {
+            const auto found = summarize(thread);
+            iterations.insert(iterations.end(), found.begin(), found.end());
+        }
+
+        if (argc == 4)
+        {
+            write_chrome(iterations, argv[3]);
+            std::cout << "written " << argv[3] << "\n";
+        }
+    }
+    catch (Exception& e)
+    {
+        std::cerr << argv[1] << ": " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "chess_tuning.hpp"
+
+/*
+Texel tuner for the piece square tables and piece values
+
+    tune FILE.epd [--iterations N] [--threads N] [--rate R] [--output FILE]
+
+Every line of FILE.epd is a position with the result of its game, as c9 "1-0" / "0-1" / "1/2-1/2"
+or [1.0] / [0.5] / [0.0], pgn_import --labels writes such a file from a game archive
+Starts from the tables compiled into the engine, runs N Adam steps on all positions and
+writes the result to FILE (default chess_bot_tables.hpp), rebuild the engine to use it
+*/
+
+const int DEFAULT_ITERATIONS = 500;
+const int REPORT_INTERVAL = 50;     // iterations between progress lines
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: tune FILE.epd [--iterations N] [--threads N] [--rate R] [--output FILE]\n";
+        return 1;
+    }
+
+    int iterations = DEFAULT_ITERATIONS;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    double rate = tuning::DEFAULT_RATE;
+    std::string output = "chess_bot_tables.hpp";
+
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        const std::string option = argv[i];
+        const std::string value = argv[i + 1];
+
+        if (option == "--iterations")
+            iterations = std::max(0, std::stoi(value));
+        else if (option == "--threads")
+            threads = std::max(1, std::stoi(value));
+        else if (option == "--rate")
+            rate = std::stod(value);
+        else if (option == "--output")
+            output = value;
+        else
+        {
+            std::cerr << "unknown option " << option << "\n";
+            return 1;
+        }
+    }
+
+    try {
+        using clock = std::chrono::steady_clock;
+        tuning::Parameters parameters = tuning::current_parameters();
+
+        auto start = clock::now();
+        std::size_t skipped = 0;
+        const tuning::PositionBatch batch = tuning::load_positions(argv[1], parameters, threads, skipped);
+        std::chrono::duration<double> elapsed = clock::now() - start;
+        std::cout << batch.size() << " positions, " << skipped << " lines skipped, loaded in " << elapsed.count() << " s\n";
+
+        const double scaling = tuning::best_scaling(batch, tuning::feature_weights(parameters), threads);
+        const double start_error = tuning::error(batch, tuning::feature_weights(parameters), scaling, threads);
+        std::cout << "K " << scaling << ", error " << start_error << "\n";
+
+        tuning::Optimizer optimizer{rate};
+        start = clock::now();
+        for (int iteration = 1; iteration <= iterations; ++iteration)
+        {
+            const std::vector<float> weights = tuning::feature_weights(parameters);
+            optimizer.step(parameters, tuning::parameter_gradient(parameters, tuning::feature_gradient(batch, weights, scaling, threads)));
+
+            if (iteration % REPORT_INTERVAL == 0 || iteration == iterations)
+            {
+                elapsed = clock::now() - start;
+                std::cout << "iteration " << iteration << ", error " << tuning::error(batch, tuning::feature_weights(parameters), scaling, threads)
+                          << ", " << elapsed.count() / iteration * 1000 << " ms per step\n";
+            }
+        }
+
+        const double final_error = tuning::error(batch, tuning::feature_weights(parameters), scaling, threads);
+        std::ostringstream comment;
+        comment << "piece square tables and piece values of the evaluation\n"
+                << "generated by tune, " << batch.size() << " positions, " << iterations << " iterations, K " << scaling
+                << ", error " << start_error << " -> " << final_error;
+        tuning::write_header(parameters, output, comment.str());
+        std::cout << "written " << output << "\n";
+    }
+    catch (Exception& e)
+    {
+        std::cerr << argv[1] << ": " << e.what() << "\n";
+        return 1;
+    }
+}